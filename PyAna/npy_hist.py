@@ -0,0 +1,45 @@
+"""
+Load the histogram exports of macros/Export/export_projections.C
+
+All arrays are memory mapped (np.load(..., mmap_mode="r")), so loading is
+instant and only the parts that are used are read from disk.
+
+    import npy_hist
+    h = npy_hist.load("npy/", "hHit2_p0_6")     # dense: h["contents"][ix, iy], h["edges"][0]
+    s = npy_hist.load("npy/", "hHit2_coo")      # coo: s["coords"], s["contents"]
+    d = npy_hist.coo_project(s, [0, 6])         # dense projection of a coo export
+"""
+
+import json
+import os
+
+import numpy as np
+
+
+def load(directory, name):
+    with open(os.path.join(directory, name + ".json")) as f:
+        h = json.load(f)
+
+    def arr(a):
+        path = os.path.join(directory, "%s.%s.npy" % (name, a))
+        return np.load(path, mmap_mode="r") if os.path.exists(path) else None
+
+    h["edges"] = [arr("edges%d" % d) for d in range(len(h["axes"]))]
+    h["contents"] = arr("contents")
+    h["errors"] = arr("errors")
+    if h["layout"] == "coo":
+        h["coords"] = arr("coords")
+    return h
+
+
+def coo_project(h, dims, flow=False):
+    """Dense projection of a coo export on the given axes (sum of contents, sum of errors^2)."""
+    shape = [h["axes"][d]["nbins"] + 2 for d in dims]
+    idx = np.ravel_multi_index(tuple(h["coords"][:, d] for d in dims), shape)
+    contents = np.bincount(idx, weights=h["contents"], minlength=np.prod(shape)).reshape(shape)
+    err2 = h["errors"] ** 2 if h["errors"] is not None else h["contents"]
+    errors = np.sqrt(np.bincount(idx, weights=err2, minlength=np.prod(shape)).reshape(shape))
+    if not flow:
+        inner = tuple(slice(1, -1) for _ in dims)
+        contents, errors = contents[inner], errors[inner]
+    return {"contents": contents, "errors": errors, "edges": [h["edges"][d] for d in dims]}
@@ -0,0 +1,27 @@
+#!/bin/bash
+
+# Build a synthetic TrackCaloSkim file (once) and run the include_wire
+# microbenchmarks on it. Results land in <output_directory>/bench_<commit>.json
+
+if [ "$#" -lt 1 ]; then
+    echo "Usage: $0 <output_directory> [N synthetic tracks]"
+    exit 1
+fi
+
+OUTPUT_DIR=$1
+N_TRACKS=${2:-2000}
+
+BENCH_DIR=$WIREMOD_WORKING_DIR/macros/Bench
+
+mkdir -p "$OUTPUT_DIR"
+
+SYNTH_FILE="$OUTPUT_DIR/synthetic_caloskim_${N_TRACKS}.root"
+if [ ! -f "$SYNTH_FILE" ]; then
+    root -l -b -q "$BENCH_DIR/make_synthetic_caloskim.C(\"$SYNTH_FILE\", $N_TRACKS)" || exit 1
+fi
+
+COMMIT=${WIREMOD_BENCH_COMMIT:-$(git -C "$WIREMOD_WORKING_DIR" rev-parse --short HEAD 2>/dev/null)}
+export WIREMOD_BENCH_COMMIT=$COMMIT
+
+# compiled (ACLiC, -O2) so the numbers reflect the optimized code
+root -l -b -q "$BENCH_DIR/bench_include_wire.C+O(\"$OUTPUT_DIR/bench_${COMMIT}.json\", \"$SYNTH_FILE\")"
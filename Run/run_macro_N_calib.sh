@@ -35,7 +35,7 @@ process_file() {
     #root -l -b -q "$ROOT_MACRO+(\"$file\")"
     timeout $timeout_duration root -l -b -q "$ROOT_MACRO(\"$file\", \"$out\", \"$apply_sce\", \"$apply_yz\", \"$apply_elife\", \"$apply_recom\", \"$is_data\")" || {
         echo "Error processing $file. Skipping to the next file..."
-        continue  # Skip to the next file in case of an error
+        return 1  # the caller moves on to the next file
     }
 }
 
@@ -0,0 +1,62 @@
+#!/bin/bash
+
+# Run a native single-file filler (cmake build, e.g. build/bin/ndhist_acpts_full)
+# over the first N files of a list. Same layout as run_macro_N.sh, but without
+# the ROOT startup / JIT per file. Extra arguments are passed to the filler,
+# e.g. --calib --data
+#
+# TIMEOUT=<seconds> kills a file after that time (default: no timeout)
+
+if [ "$#" -lt 4 ]; then
+    echo "Usage: $0 <files.list> <filler binary> <output_directory> <N files> [filler options]"
+    exit 1
+fi
+
+# Input arguments
+FILES_LIST=$1
+FILLER=$2
+OUTPUT_DIR=$3
+N_FILES=$4
+shift 4
+FILLER_OPTS="$@"
+
+NUM_JOBS=${NUM_JOBS:-4}  # Number of parallel jobs
+TIMEOUT=${TIMEOUT:-0}
+
+
+process_file() {
+    local file=$1
+    local out=$2
+    timeout $TIMEOUT "$FILLER" -i "$file" -o "$out" $FILLER_OPTS || {
+        echo "Error processing $file"
+        return 1
+    }
+    echo "Processed $file and saved to $out"
+}
+
+
+# Create output directory if it doesn't exist
+mkdir -p "$OUTPUT_DIR"
+
+count=0
+
+# Iterate over each file in files.list
+while IFS= read -r ROOT_FILE; do
+    if (( count >= N_FILES )); then
+        break
+    fi
+    # Get the base name of the ROOT file (without path and extension)
+    BASE_NAME=$(basename "$ROOT_FILE" .root)
+    OUTPUT_FILE="$OUTPUT_DIR/${BASE_NAME}_output${count}.root"
+    ((count+=1))
+
+    process_file "$ROOT_FILE" "$OUTPUT_FILE" &
+
+    # keep NUM_JOBS files in flight
+    while (( $(jobs -rp | wc -l) >= NUM_JOBS )); do
+        wait -n
+    done
+done < "$FILES_LIST"
+
+# Wait for any remaining background processes to finish
+wait
@@ -0,0 +1,217 @@
+"""
+Local multi-file scheduler
+
+Keeps N workers busy by pulling files from one shared queue, so a slow file
+only holds its own slot (run_macro_N*.sh waits for whole batches of 4).
+Each file gets a timeout and a number of retries; files that still fail are
+written to <output_dir>/failed_files.txt, which is a valid input list for a
+rerun. The outputs of this run (and only those) can be hadd'ed at the end
+(merge_files.py).
+
+Either a ROOT macro (called as macro("input", "output"[, macro args])) or a
+native filler from the cmake build (called as filler -i input -o output [opts]):
+
+  python Run/run_queue.py files.list macros/NDHist/ndhist_acpts_full.C out/ -n 200 -j 64
+  python Run/run_queue.py files.list build/bin/ndhist_acpts_full out/ -j 64 --merge merged.root -- --calib --data
+
+The *_grid fillers take a list name in $SAMPLE_PATH and an output suffix and
+write $OUTPUTROOT_PATH/output_<filler>_<suffix>.root instead. With --grid each
+file gets a one-file list and its own output directory under
+<output_dir>/jobs/, and the filler's output is moved to the job's output file
+(macro("list", "suffix"[, macro args]) or filler -l list -s suffix [opts]):
+
+  python Run/run_queue.py files.list macros/LowDim/single_dim_tpc_grid_TH1D.C out/ -j 64 --grid --macro-args "1, 1, 1, 1, 0"
+  python Run/run_queue.py files.list build/bin/multi_dim_tracks_grid out/ -j 64 --grid -- --calib --data -d 0,1,2,6,7
+"""
+
+import argparse
+import os
+import shutil
+import queue
+import signal
+import subprocess
+import sys
+import threading
+import time
+from pathlib import Path
+
+sys.path.insert(0, str(Path(__file__).resolve().parent.parent))
+from merge_files import merge_in_chunks
+
+
+def build_command(filler, input_arg, output_arg, macro_args, filler_opts, grid=False):
+    """(input file, output file), or with grid (list name, output suffix)."""
+    if filler.endswith(".C"):
+        call = f'{filler}("{input_arg}", "{output_arg}"'
+        if macro_args:
+            call += f", {macro_args}"
+        return ["root", "-l", "-b", "-q", call + ")"]
+    if grid:
+        return [filler, "-l", input_arg, "-s", output_arg] + filler_opts
+    return [filler, "-i", input_arg, "-o", output_arg] + filler_opts
+
+
+def grid_job(input_file, output_file):
+    """One-file list and output directory of a --grid job: (directory, list name, suffix)."""
+    job_dir = Path(output_file).parent / "jobs" / Path(output_file).stem
+    job_dir.mkdir(parents=True, exist_ok=True)
+    (job_dir / "input.list").write_text(input_file + "\n")
+    return job_dir, "input.list", Path(output_file).stem
+
+
+def collect_grid_output(job_dir, suffix, output_file):
+    """Move the filler's output_<filler>_<suffix>.root to output_file; False unless there is exactly one."""
+    produced = list(job_dir.glob(f"output_*_{suffix}.root"))
+    if len(produced) != 1:
+        return False
+    shutil.move(str(produced[0]), output_file)
+    return True
+
+
+def run_one(cmd, timeout, log, env=None):
+    """Run one attempt in its own process group, so a timeout also kills ROOT's children."""
+    proc = subprocess.Popen(cmd, stdout=log, stderr=subprocess.STDOUT, start_new_session=True, env=env)
+    try:
+        return proc.wait(timeout=timeout if timeout > 0 else None)
+    except subprocess.TimeoutExpired:
+        os.killpg(proc.pid, signal.SIGKILL)
+        proc.wait()
+        return "timeout"
+
+
+class Scheduler:
+
+    def __init__(self, args, jobs):
+        self.args = args
+        self.todo = queue.Queue()
+        for job in jobs:
+            self.todo.put(job)
+        self.njobs = len(jobs)
+        self.lock = threading.Lock()
+        self.done = []     # (input, output, seconds)
+        self.failed = []   # (input, reason)
+        self.start = time.time()
+
+    def report(self, line):
+        with self.lock:
+            ndone = len(self.done) + len(self.failed)
+            rate = ndone / max(time.time() - self.start, 1e-9)
+            eta = (self.njobs - ndone) / rate if rate > 0 else 0
+            print(f"[{ndone}/{self.njobs}, {rate * 60:.1f} files/min, eta {eta / 60:.1f} min] {line}", flush=True)
+
+    def worker(self):
+        while True:
+            try:
+                input_file, output_file, log_file = self.todo.get_nowait()
+            except queue.Empty:
+                return
+            env = None
+            if self.args.grid:
+                job_dir, list_name, suffix = grid_job(input_file, output_file)
+                env = dict(os.environ, SAMPLE_PATH=str(job_dir), OUTPUTROOT_PATH=str(job_dir))
+                cmd = build_command(self.args.filler, list_name, suffix, self.args.macro_args, self.args.filler_opts, grid=True)
+            else:
+                cmd = build_command(self.args.filler, input_file, output_file, self.args.macro_args, self.args.filler_opts)
+            reason = None
+            t0 = time.time()
+            for attempt in range(1 + self.args.retries):
+                if self.args.grid:
+                    for stale in job_dir.glob("output_*.root"):
+                        stale.unlink()
+                with open(log_file, "a") as log:
+                    log.write(f"# attempt {attempt + 1}: {' '.join(cmd)}\n")
+                    log.flush()
+                    status = run_one(cmd, self.args.timeout, log, env)
+                if status == 0 and self.args.grid:
+                    collect_grid_output(job_dir, suffix, output_file)
+                if status == 0 and os.path.exists(output_file):
+                    reason = None
+                    break
+                reason = "timeout" if status == "timeout" else f"exit {status}" if status != 0 else "no output"
+                if os.path.exists(output_file):
+                    os.remove(output_file)  # never merge a partial output
+            if self.args.grid and reason is None:
+                shutil.rmtree(job_dir, ignore_errors=True)
+            with self.lock:
+                if reason is None:
+                    self.done.append((input_file, output_file, time.time() - t0))
+                else:
+                    self.failed.append((input_file, reason))
+            if reason is None:
+                self.report(f"{Path(input_file).name} ({time.time() - t0:.0f} s)")
+            else:
+                self.report(f"FAILED {Path(input_file).name}: {reason} after {attempt + 1} attempt(s), see {log_file}")
+
+    def run(self):
+        threads = [threading.Thread(target=self.worker, daemon=True) for _ in range(min(self.args.jobs, self.njobs))]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Run a filler over a list of files with N workers")
+    parser.add_argument("files_list", help="input file list, one file per line")
+    parser.add_argument("filler", help="ROOT macro (.C) or native filler binary")
+    parser.add_argument("output_dir")
+    parser.add_argument("-n", "--nfiles", type=int, default=0, help="first N files of the list (default: all)")
+    parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count(), help="number of workers (default: all cores)")
+    parser.add_argument("-t", "--timeout", type=float, default=0, help="seconds per attempt, 0 = none (default)")
+    parser.add_argument("-r", "--retries", type=int, default=1, help="retries of a failed file (default: 1)")
+    parser.add_argument("--grid", action="store_true",
+                        help="the filler takes a list name in $SAMPLE_PATH and an output suffix (*_grid fillers)")
+    parser.add_argument("--macro-args", default="", help='extra macro arguments, e.g. "1, 1, 1, 1, 0"')
+    parser.add_argument("--merge", default="", help="hadd the outputs into <output_dir>/merged/<name>")
+    parser.add_argument("--merge-threads", type=int, default=8)
+    # everything after "--" goes to a native filler
+    argv = sys.argv[1:]
+    filler_opts = argv[argv.index("--") + 1:] if "--" in argv else []
+    args = parser.parse_args(argv[:argv.index("--")] if "--" in argv else argv)
+    args.filler_opts = filler_opts
+
+    with open(args.files_list) as f:
+        files = [line.strip() for line in f if line.strip() and not line.startswith("#")]
+    if args.nfiles > 0:
+        files = files[:args.nfiles]
+
+    output_dir = Path(args.output_dir)
+    log_dir = output_dir / "logs"
+    log_dir.mkdir(parents=True, exist_ok=True)
+    jobs = []
+    for count, input_file in enumerate(files):
+        base_name = Path(input_file).name.replace(".root", "")
+        output_file = output_dir / f"{base_name}_output{count}.root"
+        jobs.append((input_file, str(output_file), str(log_dir / f"{base_name}_output{count}.log")))
+
+    print(f"{len(jobs)} files, {min(args.jobs, len(jobs))} workers, timeout {args.timeout:.0f} s, {args.retries} retries")
+    sched = Scheduler(args, jobs)
+    sched.run()
+
+    wall = time.time() - sched.start
+    busy = sum(d[2] for d in sched.done)
+    print(f"Done: {len(sched.done)} ok, {len(sched.failed)} failed in {wall:.0f} s"
+          f" ({busy / max(wall, 1e-9):.1f} files in flight on average)")
+
+    failed_list = output_dir / "failed_files.txt"
+    if sched.failed:
+        with open(failed_list, "w") as f:
+            for input_file, reason in sched.failed:
+                f.write(f"{input_file}\n")
+        print(f"Failed files (rerun with {failed_list}):")
+        for input_file, reason in sched.failed:
+            print(f"  {reason:>10}  {input_file}")
+    elif failed_list.exists():
+        failed_list.unlink()
+
+    if args.merge and sched.done:
+        merge_dir = output_dir / "merged"
+        # only this run's outputs, not whatever earlier runs left in output_dir
+        outputs = [output_file for _, output_file, _ in sched.done]
+        merge_in_chunks(output_dir, merge_dir, args.merge, chunk_size=100, threads=args.merge_threads, files=outputs)
+
+    return 1 if sched.failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,66 @@
+#!/bin/bash
+
+# Run N local workers of the native multi_dim_tracks_grid on one node, all
+# adding their hHit/hTrack to one shared memory table (WIREMOD_SHM,
+# include_wire/SharedHist.h). The list is split into N equal-work entry
+# ranges (grid/plan_shards.py); once every worker has finished or died, one
+# of the finished ones writes
+# <output_directory>/output_multi_dim_tracks_<name>.root, so there is nothing
+# to merge. If no worker finished, the table stays in /dev/shm/<name>. Extra arguments are passed to the filler, e.g. --calib --data -d 0,1,2,6,7
+#
+# FILLER=<binary>     default build/bin/multi_dim_tracks_grid
+# WIREMOD_SHM_MB=<MB> size of the shared table (default 4096)
+# Use WIREMOD_CALIB_BUNDLE as well: the workers then map the calibration
+# tables read only instead of loading a copy each.
+
+if [ "$#" -lt 3 ]; then
+    echo "Usage: $0 <files.list> <N workers> <output_directory> [filler options]"
+    exit 1
+fi
+
+FILES_LIST=$1
+N_WORKERS=$2
+OUTPUT_DIR=$3
+shift 3
+FILLER_OPTS="$@"
+
+SCRIPT_DIR=$(cd "$(dirname "$0")" && pwd)
+FILLER=${FILLER:-$SCRIPT_DIR/../build/bin/multi_dim_tracks_grid}
+SHARDS_DIR="$OUTPUT_DIR/shards"
+SHM_NAME=${SHM_NAME:-wiremod_shm_$$}
+
+mkdir -p "$SHARDS_DIR"
+rm -f "$SHARDS_DIR"/input_list_*.txt "$SHARDS_DIR"/entry_range_*.txt
+python3 "$SCRIPT_DIR/../grid/plan_shards.py" "$FILES_LIST" "$N_WORKERS" "$SHARDS_DIR" || exit 1
+
+# the planner drops empty shards
+N_SHARDS=$(ls "$SHARDS_DIR"/input_list_*.txt | wc -l)
+rm -f "/dev/shm/$SHM_NAME" "$OUTPUT_DIR/output_multi_dim_tracks_$SHM_NAME.root"
+
+PIDS=()
+for (( i = 0; i < N_SHARDS; i++ )); do
+    read FIRST_ENTRY LAST_ENTRY < "$SHARDS_DIR/entry_range_$i.txt"
+    WIREMOD_SHM=$SHM_NAME WIREMOD_SHM_WORKERS=$N_SHARDS SAMPLE_PATH="$SHARDS_DIR" OUTPUTROOT_PATH="$OUTPUT_DIR" \
+        "$FILLER" -l "input_list_$i.txt" -s "$i" --first "$FIRST_ENTRY" --last "$LAST_ENTRY" $FILLER_OPTS \
+        &> "$OUTPUT_DIR/log_$i.log" &
+    PIDS+=($!)
+done
+N_FAILED=0
+for (( i = 0; i < N_SHARDS; i++ )); do
+    if ! wait "${PIDS[$i]}"; then
+        echo "Worker $i failed, see $OUTPUT_DIR/log_$i.log"
+        N_FAILED=$((N_FAILED + 1))
+    fi
+done
+
+# the writing worker removes the region; without a dump it is kept
+SHM_OUTPUT="$OUTPUT_DIR/output_multi_dim_tracks_$SHM_NAME.root"
+if [ -e "/dev/shm/$SHM_NAME" ] || [ ! -e "$SHM_OUTPUT" ]; then
+    echo "No shared output: the table is kept in /dev/shm/$SHM_NAME (remove it when done)"
+    exit 1
+fi
+echo "Shared histograms: $SHM_OUTPUT"
+if [ "$N_FAILED" -gt 0 ]; then
+    echo "$N_FAILED of $N_SHARDS workers failed: their entries are (partly) missing"
+    exit 1
+fi
@@ -0,0 +1,181 @@
+#ifndef FILLER_OPTIONS_H
+#define FILLER_OPTIONS_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstdlib>
+#include <getopt.h>
+
+#include "TString.h"
+
+
+/*
+
+  Command line options of the native filler executables (apps/filler_main.cxx)
+
+  The options map one to one onto the positional arguments of the ROOT macros,
+  so a grid line like
+    root -l -b -q "multi_dim_tracks_grid.C(\"list.txt\", \"0\", true, true, true, true, true, {0, 1, 2, 6, 7}, false, false, true, false)"
+  becomes
+    multi_dim_tracks_grid -l list.txt -s 0 --calib --data -d 0,1,2,6,7 --no-tpc-sel --pathological-sel
+
+  The macro signature a binary calls is fixed at compile time through
+  WIREMOD_FILLER_SIG (see CMakeLists.txt).
+
+*/
+
+// Macro signatures
+#define WIREMOD_SIG_MULTI      1 // (list, suffix, sce, yz, elife, recom, data, vector<int> dim, tpc, crt, path, life, first, last)
+#define WIREMOD_SIG_SINGLE     2 // (list, suffix, sce, yz, elife, recom, data, int dim, tpc, crt, path, life)
+#define WIREMOD_SIG_CALIB      3 // (list, suffix, sce, yz, elife, recom, data)
+#define WIREMOD_SIG_CALIB_DIM  4 // (list, suffix, sce, yz, elife, recom, data, int dim)
+#define WIREMOD_SIG_CALIB_DIM2 5 // (list, suffix, sce, yz, elife, recom, data, int dimx, int dimy)
+#define WIREMOD_SIG_MERGE      6 // (list, suffix, vector<int> dim, vector<int> pyramid, variant)
+#define WIREMOD_SIG_FILE       7 // (input, output, sce, yz, elife, data)
+#define WIREMOD_SIG_FILE_RECOM 8 // (input, output, sce, yz, elife, recom, data)
+
+
+struct FillerOptions {
+
+  TString list_file;   // relative to $SAMPLE_PATH, as for the macros
+  TString out_suffix;
+  TString input_file;  // single file fillers
+  TString output_file;
+
+  bool apply_sce = false;
+  bool apply_yz = false;
+  bool apply_elife = false;
+  bool apply_recom = false;
+  bool isData = false;
+
+  std::vector<int> dim = {0};
+  int dimx = 1;
+  int dimy = 2;
+
+  bool tpc_sel = true;
+  bool crt_sel = false;
+  bool pathological_sel = false;
+  bool life_sel = false;
+
+  Long64_t first_entry = 0;  // global entry range over the list
+  Long64_t last_entry = -1;
+
+  std::vector<int> pyramid;  // merger: coarse levels (HistPyramid.h)
+  TString variant;           // merger: WIREMOD_VARIANTS directory to read
+
+  static std::vector<int> ParseDims(const std::string& s) {
+    std::vector<int> out;
+    std::stringstream ss(s);
+    std::string tok;
+    while (std::getline(ss, tok, ',')) {
+      if (!tok.empty()) out.push_back(atoi(tok.c_str()));
+    }
+    return out;
+  }
+
+  static void Usage(const char* prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("  -l, --list FILE          input file list (in $SAMPLE_PATH)\n");
+    printf("  -s, --suffix STR         output suffix\n");
+    printf("  -i, --input FILE         input file (single file fillers)\n");
+    printf("  -o, --output FILE        output file (single file fillers)\n");
+    printf("      --sce, --yz, --elife, --recom\n");
+    printf("                           apply the calibration\n");
+    printf("      --calib              all four calibrations\n");
+    printf("      --data               input is data\n");
+    printf("  -d, --dim LIST           dimensions, e.g. 0,1,2,6,7 (single dim fillers use the first)\n");
+    printf("      --dimx N, --dimy N   dimensions of the 2D fillers\n");
+    printf("      --no-tpc-sel         do not require a TPC t0\n");
+    printf("      --crt-sel            CRT t0 only\n");
+    printf("      --pathological-sel   reject pathological hits\n");
+    printf("      --life-sel           lifetime selection (anode-cathode crossers)\n");
+    printf("      --first N, --last N  process the chain entries [first, last) only (multi dim fillers)\n");
+    printf("      --pyramid LIST       coarse levels to write, e.g. 2,4 (merge_hists_grid)\n");
+    printf("      --variant NAME       variant directory of the filler outputs (merge_hists_grid)\n");
+    printf("  -h, --help\n");
+  }
+
+  bool Parse(int argc, char** argv) {
+    enum { kSCE = 1000, kYZ, kElife, kRecom, kCalib, kData, kDimX, kDimY, kNoTPC, kCRT, kPath, kLife, kFirst, kLast, kPyramid, kVariant };
+    static struct option long_opts[] = {
+      {"list", required_argument, 0, 'l'},
+      {"suffix", required_argument, 0, 's'},
+      {"input", required_argument, 0, 'i'},
+      {"output", required_argument, 0, 'o'},
+      {"dim", required_argument, 0, 'd'},
+      {"sce", no_argument, 0, kSCE},
+      {"yz", no_argument, 0, kYZ},
+      {"elife", no_argument, 0, kElife},
+      {"recom", no_argument, 0, kRecom},
+      {"calib", no_argument, 0, kCalib},
+      {"data", no_argument, 0, kData},
+      {"dimx", required_argument, 0, kDimX},
+      {"dimy", required_argument, 0, kDimY},
+      {"no-tpc-sel", no_argument, 0, kNoTPC},
+      {"crt-sel", no_argument, 0, kCRT},
+      {"pathological-sel", no_argument, 0, kPath},
+      {"life-sel", no_argument, 0, kLife},
+      {"first", required_argument, 0, kFirst},
+      {"last", required_argument, 0, kLast},
+      {"pyramid", required_argument, 0, kPyramid},
+      {"variant", required_argument, 0, kVariant},
+      {"help", no_argument, 0, 'h'},
+      {0, 0, 0, 0}
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "l:s:i:o:d:h", long_opts, nullptr)) != -1) {
+      switch (c) {
+        case 'l': list_file = optarg; break;
+        case 's': out_suffix = optarg; break;
+        case 'i': input_file = optarg; break;
+        case 'o': output_file = optarg; break;
+        case 'd': dim = ParseDims(optarg); break;
+        case kSCE: apply_sce = true; break;
+        case kYZ: apply_yz = true; break;
+        case kElife: apply_elife = true; break;
+        case kRecom: apply_recom = true; break;
+        case kCalib: apply_sce = apply_yz = apply_elife = apply_recom = true; break;
+        case kData: isData = true; break;
+        case kDimX: dimx = atoi(optarg); break;
+        case kDimY: dimy = atoi(optarg); break;
+        case kNoTPC: tpc_sel = false; break;
+        case kCRT: crt_sel = true; break;
+        case kPath: pathological_sel = true; break;
+        case kLife: life_sel = true; break;
+        case kFirst: first_entry = atoll(optarg); break;
+        case kLast: last_entry = atoll(optarg); break;
+        case kPyramid: pyramid = ParseDims(optarg); break;
+        case kVariant: variant = optarg; break;
+        case 'h': Usage(argv[0]); return false;
+        default: Usage(argv[0]); return false;
+      }
+    }
+    if (dim.empty()) {
+      std::cerr << argv[0] << ": empty --dim" << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  bool RequireList(const char* prog) const {
+    if (list_file == "" || out_suffix == "") {
+      std::cerr << prog << ": --list and --suffix are required" << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  bool RequireFiles(const char* prog) const {
+    if (input_file == "" || output_file == "") {
+      std::cerr << prog << ": --input and --output are required" << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+};
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * Native entry point for the filler macros
+ * CMake compiles this once per filler with
+ *   WIREMOD_MACRO        path of the macro to include
+ *   WIREMOD_FILLER_FUNC  function the macro defines
+ *   WIREMOD_FILLER_SIG   its signature (FillerOptions.h)
+ * so every binary is a single translation unit, like the macro under ROOT.
+ */
+
+// Cling provides these to the macros implicitly
+#include "TROOT.h"
+#include "TSystem.h"
+#include "TChain.h"
+#include "TTree.h"
+#include "TF1.h"
+#include "TH1D.h"
+#include "TH2D.h"
+#include "TH3D.h"
+#include "TMath.h"
+#include "TRandom3.h"
+#include "TStyle.h"
+#include "TCanvas.h"
+
+#include "FillerOptions.h"
+
+#include WIREMOD_MACRO
+
+#define WIREMOD_STR2(x) #x
+#define WIREMOD_STR(x) WIREMOD_STR2(x)
+
+
+int main(int argc, char** argv) {
+
+    const char* prog = WIREMOD_STR(WIREMOD_FILLER_FUNC);
+
+    FillerOptions opt;
+    if (!opt.Parse(argc, argv)) return 1;
+
+    gROOT->SetBatch(true);
+
+#if WIREMOD_FILLER_SIG == WIREMOD_SIG_MULTI
+    if (!opt.RequireList(prog)) return 1;
+    WIREMOD_FILLER_FUNC(opt.list_file, opt.out_suffix, opt.apply_sce, opt.apply_yz, opt.apply_elife,
+                        opt.apply_recom, opt.isData, opt.dim,
+                        opt.tpc_sel, opt.crt_sel, opt.pathological_sel, opt.life_sel,
+                        opt.first_entry, opt.last_entry);
+#elif WIREMOD_FILLER_SIG == WIREMOD_SIG_SINGLE
+    if (!opt.RequireList(prog)) return 1;
+    WIREMOD_FILLER_FUNC(opt.list_file, opt.out_suffix, opt.apply_sce, opt.apply_yz, opt.apply_elife,
+                        opt.apply_recom, opt.isData, opt.dim[0],
+                        opt.tpc_sel, opt.crt_sel, opt.pathological_sel, opt.life_sel);
+#elif WIREMOD_FILLER_SIG == WIREMOD_SIG_CALIB
+    if (!opt.RequireList(prog)) return 1;
+    WIREMOD_FILLER_FUNC(opt.list_file, opt.out_suffix, opt.apply_sce, opt.apply_yz, opt.apply_elife,
+                        opt.apply_recom, opt.isData);
+#elif WIREMOD_FILLER_SIG == WIREMOD_SIG_CALIB_DIM
+    if (!opt.RequireList(prog)) return 1;
+    WIREMOD_FILLER_FUNC(opt.list_file, opt.out_suffix, opt.apply_sce, opt.apply_yz, opt.apply_elife,
+                        opt.apply_recom, opt.isData, opt.dim[0]);
+#elif WIREMOD_FILLER_SIG == WIREMOD_SIG_CALIB_DIM2
+    if (!opt.RequireList(prog)) return 1;
+    WIREMOD_FILLER_FUNC(opt.list_file, opt.out_suffix, opt.apply_sce, opt.apply_yz, opt.apply_elife,
+                        opt.apply_recom, opt.isData, opt.dimx, opt.dimy);
+#elif WIREMOD_FILLER_SIG == WIREMOD_SIG_MERGE
+    if (!opt.RequireList(prog)) return 1;
+    WIREMOD_FILLER_FUNC(opt.list_file, opt.out_suffix, opt.dim, opt.pyramid, opt.variant);
+#elif WIREMOD_FILLER_SIG == WIREMOD_SIG_FILE
+    if (!opt.RequireFiles(prog)) return 1;
+    WIREMOD_FILLER_FUNC(opt.input_file.Data(), opt.output_file.Data(), opt.apply_sce, opt.apply_yz,
+                        opt.apply_elife, opt.isData);
+#elif WIREMOD_FILLER_SIG == WIREMOD_SIG_FILE_RECOM
+    if (!opt.RequireFiles(prog)) return 1;
+    WIREMOD_FILLER_FUNC(opt.input_file.Data(), opt.output_file.Data(), opt.apply_sce, opt.apply_yz,
+                        opt.apply_elife, opt.apply_recom, opt.isData);
+#else
+#error "unknown WIREMOD_FILLER_SIG"
+#endif
+
+    return 0;
+}
@@ -24,12 +24,23 @@ ls -alh ${filesFromSender}
 echo "@@ copy scripts"
 mkdir -p data/sample_list/sbndgpvm/
 cp ${filesFromSender}/input_list_${nProcess}.txt ./data/sample_list/sbndgpvm/
+# entry range of this job (submit with -balance), "first last" over the chain of the list
+FIRST_ENTRY=0
+LAST_ENTRY=-1
+if [ -f ${filesFromSender}/entry_range_${nProcess}.txt ]; then
+  read FIRST_ENTRY LAST_ENTRY < ${filesFromSender}/entry_range_${nProcess}.txt
+fi
+echo "@@ entry range : ${FIRST_ENTRY} ${LAST_ENTRY}"
 ls -alh ./data/sample_list/sbndgpvm/
 cp ${filesFromSender}/setup_grid.sh .
 cp -r ${filesFromSender}/bin .
 cp -r ${filesFromSender}/include .
 cp -r ${filesFromSender}/include_wire .
 cp -r ${filesFromSender}/multi_dim_tracks_grid.C .
+if [ -f ${filesFromSender}/multi_dim_tracks_grid ]; then
+  cp ${filesFromSender}/multi_dim_tracks_grid .
+  chmod +x multi_dim_tracks_grid
+fi
 
 echo "@@ make output/root"
 mkdir -p output/root
@@ -68,7 +79,12 @@ echo "@@ run"
 # 8 = Goodness
 # 9 = Pathological
 
-root -l -b -q "multi_dim_tracks_grid.C(\"input_list_${nProcess}.txt\", \"${nProcess}\", true, true, true, true, true, {0, 1, 2, 6, 7}, false, false, true, false)" &> log_${nProcess}.log
+# the native filler (submit with -native) takes the same configuration as command line options
+if [ -x ./multi_dim_tracks_grid ]; then
+  ./multi_dim_tracks_grid -l input_list_${nProcess}.txt -s ${nProcess} --calib --data -d 0,1,2,6,7 --no-tpc-sel --pathological-sel --first ${FIRST_ENTRY} --last ${LAST_ENTRY} &> log_${nProcess}.log
+else
+  root -l -b -q "multi_dim_tracks_grid.C(\"input_list_${nProcess}.txt\", \"${nProcess}\", true, true, true, true, true, {0, 1, 2, 6, 7}, false, false, true, false, ${FIRST_ENTRY}, ${LAST_ENTRY})" &> log_${nProcess}.log
+fi
 
 
 # //////////////////////////////////////////////////////////
@@ -0,0 +1,155 @@
+"""
+Equal-work shard planner for the multi dim fillers
+
+Splitting by file count gives jobs with very different numbers of selected
+tracks. This counts the entries and the selected tracks (trk.selected > 0) of
+every file once, then cuts the global entry axis of the list (the chain the
+filler builds) at equal cumulative work:
+
+    work(file) = selected tracks + entry_weight * entries
+
+Inside a file the work is taken as uniform in the entry number. Each shard is
+written as the files it touches plus an entry range relative to the first of
+them, which is what the filler gets through first_entry/last_entry (--first/
+--last). Every entry lands in exactly one shard, so hadd of the shard outputs
+equals the unsharded output.
+
+The counts are cached in <list>.counts.json, so replanning is free.
+
+  python plan_shards.py files.list 100 shards/       -> shards/input_list_<i>.txt, shards/entry_range_<i>.txt
+"""
+
+import argparse
+import json
+import os
+import sys
+
+TREE_NAME = "caloskim/TrackCaloSkim"
+
+
+def read_list(path):
+    # same rule as submit_multi_dim_tracks.py
+    files = []
+    for line in open(path):
+        if "#" in line:
+            continue
+        line = line.strip("\n")
+        if line.strip():
+            files.append(line)
+    return files
+
+
+def count_file(path):
+    import ROOT
+    f = ROOT.TFile.Open(path)
+    if not f or f.IsZombie():
+        raise RuntimeError("cannot open " + path)
+    t = f.Get(TREE_NAME)
+    if not t:
+        raise RuntimeError("no %s in %s" % (TREE_NAME, path))
+    entries = int(t.GetEntries())
+    t.SetBranchStatus("*", 0)
+    t.SetBranchStatus("trk.selected", 1)
+    selected = int(t.GetEntries("trk.selected > 0"))
+    f.Close()
+    return entries, selected
+
+
+def load_counts(files, cache_path, nthreads=8):
+    cache = {}
+    if os.path.exists(cache_path):
+        cache = json.load(open(cache_path))
+    todo = [f for f in files if f not in cache]
+    if todo:
+        from concurrent.futures import ThreadPoolExecutor
+        print("Counting entries of %d files" % len(todo))
+        with ThreadPoolExecutor(max_workers=nthreads) as executor:
+            for f, (n, s) in zip(todo, executor.map(count_file, todo)):
+                cache[f] = [n, s]
+        with open(cache_path, "w") as out:
+            json.dump(cache, out, indent=0)
+    return [tuple(cache[f]) for f in files]
+
+
+def plan(counts, nshards, entry_weight=0.05):
+    """Cut the global entry axis into nshards ranges [first, last) of equal work."""
+    if nshards < 1:
+        raise ValueError("nshards must be >= 1, got %d" % nshards)
+    work = [s + entry_weight * n for n, s in counts]
+    total = sum(work)
+    offsets = [0]
+    for n, _ in counts:
+        offsets.append(offsets[-1] + n)
+    nentries = offsets[-1]
+
+    cuts = [0]
+    acc = 0.
+    ifile = 0
+    for k in range(1, nshards):
+        target = total * k / nshards
+        while ifile < len(counts) and acc + work[ifile] < target:
+            acc += work[ifile]
+            ifile += 1
+        if ifile == len(counts):
+            cuts.append(nentries)
+            continue
+        n = counts[ifile][0]
+        frac = (target - acc) / work[ifile] if work[ifile] > 0 else 0.
+        cuts.append(max(cuts[-1], offsets[ifile] + int(round(frac * n))))
+    cuts.append(nentries)
+    return [(cuts[k], cuts[k + 1]) for k in range(nshards)], offsets, work
+
+
+def shard_files(first, last, offsets):
+    """Files overlapping [first, last) and the range relative to the first of them."""
+    ifirst = max(i for i in range(len(offsets) - 1) if offsets[i] <= first) if first < offsets[-1] else len(offsets) - 2
+    ilast = ifirst
+    while ilast + 1 < len(offsets) - 1 and offsets[ilast + 1] < last:
+        ilast += 1
+    return list(range(ifirst, ilast + 1)), first - offsets[ifirst], last - offsets[ifirst]
+
+
+def write_shards(files, counts, nshards, out_dir, entry_weight=0.05):
+    ranges, offsets, work = plan(counts, nshards, entry_weight)
+    os.makedirs(out_dir, exist_ok=True)
+    total = sum(work)
+    shards = []
+    for i, (first, last) in enumerate(ranges):
+        if last <= first:
+            continue
+        ifiles, lfirst, llast = shard_files(first, last, offsets)
+        j = len(shards)
+        with open(os.path.join(out_dir, "input_list_%d.txt" % j), "w") as out:
+            for f in ifiles:
+                out.write(files[f] + "\n")
+        with open(os.path.join(out_dir, "entry_range_%d.txt" % j), "w") as out:
+            out.write("%d %d\n" % (lfirst, llast))
+        shard_work = sum(work[f] * (min(last, offsets[f + 1]) - max(first, offsets[f])) / max(counts[f][0], 1) for f in ifiles)
+        shards.append((first, last, len(ifiles), shard_work))
+    print("%d shards over %d files, %d entries, %.0f selected tracks" % (
+        len(shards), len(files), offsets[-1], sum(s for _, s in counts)))
+    if shards:
+        ws = [s[3] for s in shards]
+        print("work per shard: mean %.0f, min %.0f, max %.0f (%.2f x mean)" % (
+            total / len(shards), min(ws), max(ws), max(ws) / (total / len(shards)) if total > 0 else 0))
+    return shards
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Split a file list into equal-work entry range shards")
+    parser.add_argument("files_list")
+    parser.add_argument("nshards", type=int)
+    parser.add_argument("out_dir")
+    parser.add_argument("--entry-weight", type=float, default=0.05, help="work of one entry relative to a selected track (default 0.05)")
+    parser.add_argument("--threads", type=int, default=8, help="files counted in parallel")
+    args = parser.parse_args()
+    if args.nshards < 1:
+        parser.error("nshards must be >= 1")
+
+    files = read_list(args.files_list)
+    counts = load_counts(files, args.files_list + ".counts.json", args.threads)
+    write_shards(files, counts, args.nshards, args.out_dir, args.entry_weight)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
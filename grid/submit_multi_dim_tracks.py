@@ -22,7 +22,11 @@ parser.add_argument('-i', dest='inputfiles', default="", help="input root file p
 parser.add_argument('-l', dest='inputfilelist', default="", help="a file of list for input root files")
 parser.add_argument('-ngrid', dest='NGridJobs', default=0, type=int, help="Number of grid jobs. Default = 0, no grid submission.")
 parser.add_argument('-nfile', dest='NFiles', default=0, type=int, help="Number of files to run. Default = 0, run all input files.")
+parser.add_argument('-balance', dest='Balance', action='store_true', help="split the list into equal-work entry ranges (plan_shards.py) instead of by file count")
+parser.add_argument('-native', dest='Native', action='store_true', help="ship the compiled filler ($WIREMOD_BUILD_DIR/bin, default $WIREMOD_WORKING_DIR/build) instead of running the macro in ROOT")
 args = parser.parse_args()
+if args.Balance and args.NGridJobs < 1:
+    parser.error("-balance needs -ngrid N with N >= 1 (the number of shards)")
 
 
 def run_grid(inputfiles):
@@ -36,21 +40,33 @@ def run_grid(inputfiles):
     OutputDir = SBNDCALIB_GRID_OUT_DIR + "/multi_dim_tracks/" + args.output + "__" + timestamp
     os.system('mkdir -p ' + MasterJobDir)
 
-    # 3) grid job is based on number of files
+    # 3) grid job is based on number of files, or on entries with -balance
     ngrid = args.NGridJobs
-    if(len(inputfiles) <= ngrid):
+    if(len(inputfiles) <= ngrid and not args.Balance):
         ngrid = len(inputfiles)
 
     NInputfiles = len(inputfiles)
     print("Number of Grid Jobs: %d, number of input calib ntuple files: %d" % (ngrid, NInputfiles))
 
     # 4) prepare bash scripts for each job and make tarball
+    if args.Balance:
+        # input_list_<i>.txt + entry_range_<i>.txt per job
+        sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+        import plan_shards
+        counts_cache = (args.inputfilelist if args.inputfilelist != "" else MasterJobDir + "/input") + ".counts.json"
+        counts = plan_shards.load_counts(inputfiles, counts_cache)
+        ngrid = len(plan_shards.write_shards(inputfiles, counts, ngrid, MasterJobDir))
+        ngrid_files = 0
+    else:
+        ngrid_files = ngrid
+
     flistForEachJob = []
-    for i in range(0,ngrid):
+    for i in range(0,ngrid_files):
         flistForEachJob.append( [] )
 
     for i_line in range(0,len(inputfiles)):
-        flistForEachJob[i_line%ngrid].append(inputfiles[i_line])
+        if ngrid_files > 0:
+            flistForEachJob[i_line%ngrid_files].append(inputfiles[i_line])
 
     for i_flist in range(0,len(flistForEachJob)):
         flist = flistForEachJob[i_flist]
@@ -77,6 +93,14 @@ def run_grid(inputfiles):
     os.system(cp_BashColorSets)
     os.system(cp_script)
 
+    if args.Native:
+        build_dir = os.environ.get('WIREMOD_BUILD_DIR', WIREMOD_WORKING_DIR + "/build")
+        native_bin = build_dir + "/bin/multi_dim_tracks_grid"
+        if not os.path.isfile(native_bin):
+            print("No native filler at %s, build it with cmake first" % native_bin)
+            sys.exit(1)
+        os.system("cp " + native_bin + " " + MasterJobDir)
+
     yzunif_map_dir = os.environ['SBND_YZCORR_PATH']
     cp_yzunif_map = "cp " + yzunif_map_dir + "/*.root " + MasterJobDir
     os.system(cp_yzunif_map)
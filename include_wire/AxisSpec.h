@@ -0,0 +1,296 @@
+#ifndef AXIS_SPEC_H
+#define AXIS_SPEC_H
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <sys/stat.h>
+
+#include "TString.h"
+#include "THnSparse.h"
+
+
+/*
+
+  Uniform axes of the fillers and a fast bin lookup for THnSparse filling
+
+  AxisRegistry holds the named axes a filler can project on, in the order of
+  its dim codes (x, y, z, txz, tyz, dqdx, Q, W, G, P for the multi dim
+  fillers). Each filler starts from its own defaults; a config file with lines
+
+    # name  nbins  xmin  xmax  [title]
+    txz     180    -90   90    ThetaXZ (deg)
+
+  overrides or adds axes at run time. WIREMOD_AXES=<directory> holds one file
+  per filler, <filler>.txt (see CONST/axes/), so fillers with different
+  binnings do not override each other. A filler only accepts the dim codes it
+  has a value for (Check), added names included.
+
+  AxisSet is the selection of axes of one histogram. Bin() maps a coordinate
+  to the TAxis bin number (0 underflow, nbins + 1 overflow) with one
+  subtraction, one multiply by the precomputed nbins / (xmax - xmin) and a
+  clamp, instead of THnSparse::Fill going through TAxis::FindBin per axis.
+  BinBatch() does it for all hits of a plane at once, and Fill() adds a hit
+  through THnSparse::GetBin(coords) + FillBin, which is what Fill(x) ends with.
+
+  The product with the reciprocal can round differently from TAxis's
+  nbins * (x - xmin) / (xmax - xmin) only for a coordinate within rounding of
+  a bin edge; WIREMOD_AXIS_VALIDATE=N compares the first N lookups with
+  TAxis::FindFixBin and reports any difference.
+
+*/
+
+struct AxisSpec {
+  std::string name;
+  std::string title;
+  int nbins = 1;
+  double xmin = 0.;
+  double xmax = 1.;
+  double scale = 1.;  // nbins / (xmax - xmin)
+
+  AxisSpec() {}
+  AxisSpec(const std::string& n, int nb, double lo, double hi, const std::string& t = "")
+    : name(n), title(t == "" ? n : t), nbins(nb), xmin(lo), xmax(hi), scale(nb / (hi - lo)) {}
+
+  // Same convention as TAxis::FindFixBin; NaN goes to the overflow like there
+  inline int Bin(double x) const {
+    if (x < xmin) return 0;
+    if (!(x < xmax)) return nbins + 1;
+    int b = 1 + (int)((x - xmin) * scale);
+    return (b > nbins) ? nbins : b;
+  }
+};
+
+
+class AxisSet {
+
+  public:
+
+    AxisSet() {}
+    AxisSet(const std::vector<AxisSpec>& axes) : fAxes(axes) {
+      const char* v = getenv("WIREMOD_AXIS_VALIDATE");
+      fValidate = v ? atol(v) : 0;
+    }
+
+    size_t NDim() const { return fAxes.size(); }
+    const AxisSpec& Axis(size_t d) const { return fAxes[d]; }
+
+    // THnSparseD with these axes (titles set)
+    THnSparseD* MakeSparse(const char* name, const char* title = "") const {
+      std::vector<Int_t> nbins;
+      std::vector<Double_t> lo, hi;
+      for (const auto& a : fAxes) {
+        nbins.push_back(a.nbins);
+        lo.push_back(a.xmin);
+        hi.push_back(a.xmax);
+      }
+      THnSparseD* h = new THnSparseD(name, title, fAxes.size(), nbins.data(), lo.data(), hi.data());
+      for (size_t d = 0; d < fAxes.size(); d++) h->GetAxis(d)->SetTitle(fAxes[d].title.c_str());
+      return h;
+    }
+
+    inline void Bin(const double* x, Int_t* coord) const {
+      for (size_t d = 0; d < fAxes.size(); d++) coord[d] = fAxes[d].Bin(x[d]);
+    }
+
+    // n points given per axis (cols[d * n + k]) -> coords[k * ndim + d]
+    void BinBatch(size_t n, const double* cols, Int_t* coords) const {
+      const size_t nd = fAxes.size();
+      for (size_t d = 0; d < nd; d++) {
+        const AxisSpec& a = fAxes[d];
+        const double* c = cols + d * n;
+        for (size_t k = 0; k < n; k++) coords[k * nd + d] = a.Bin(c[k]);
+      }
+    }
+
+    // Linear bin index over all bins including under/overflow (axis 0 slowest)
+    inline Long64_t Linear(const Int_t* coord) const {
+      Long64_t idx = 0;
+      for (size_t d = 0; d < fAxes.size(); d++) idx = idx * (fAxes[d].nbins + 2) + coord[d];
+      return idx;
+    }
+
+    // Inverse of Linear
+    inline void Coords(Long64_t idx, Int_t* coord) const {
+      for (size_t d = fAxes.size(); d-- > 0;) {
+        coord[d] = idx % (fAxes[d].nbins + 2);
+        idx /= fAxes[d].nbins + 2;
+      }
+    }
+
+    // Number of linear indices (as double, it may not fit in 64 bits)
+    double LinearSize() const {
+      double n = 1.;
+      for (const auto& a : fAxes) n *= a.nbins + 2;
+      return n;
+    }
+
+    // Fill by bin coordinates; returns the THnSparse bin. Histograms with
+    // Sumw2 also keep per axis sums of x, so they go through Fill(x)
+    inline Long64_t Fill(THnSparse* h, const Int_t* coord, const double* x, double w = 1.) {
+      if (fValidate > 0) Validate(h, coord, x);
+      if (h->GetCalculateErrors()) return h->Fill(x, w);
+      Long64_t bin = h->GetBin(coord);
+      h->FillBin(bin, w);
+      return bin;
+    }
+
+    void Print() const {
+      printf("Axes:");
+      for (const auto& a : fAxes) printf(" %s[%d, %g, %g]", a.name.c_str(), a.nbins, a.xmin, a.xmax);
+      printf("\n");
+      if (fChecked > 0) printf("AxisSet: %ld lookups checked against TAxis::FindFixBin, %ld differ\n", fChecked, fMismatch);
+    }
+
+  private:
+
+    void Validate(THnSparse* h, const Int_t* coord, const double* x) {
+      fValidate--;
+      fChecked++;
+      for (size_t d = 0; d < fAxes.size(); d++) {
+        int ref = h->GetAxis(d)->FindFixBin(x[d]);
+        if (ref != coord[d]) {
+          if (fMismatch < 10) fprintf(stderr, "AxisSet: axis %s x=%.17g bin %d, TAxis %d\n", fAxes[d].name.c_str(), x[d], coord[d], ref);
+          fMismatch++;
+        }
+      }
+    }
+
+    std::vector<AxisSpec> fAxes;
+    long fValidate = 0;
+    long fChecked = 0;
+    long fMismatch = 0;
+
+};
+
+
+class AxisRegistry {
+
+  public:
+
+    static const int kMultiDimCodes = 10; // x .. P, the codes Default() starts with
+
+    // Axes of the multi dim fillers, in dim code order
+    static AxisRegistry Default() {
+      AxisRegistry r;
+      r.Set(AxisSpec("x",    200, -200, 200,  "x"));
+      r.Set(AxisSpec("y",    200, -200, 200,  "y"));
+      r.Set(AxisSpec("z",    250,    0, 500,  "z"));
+      r.Set(AxisSpec("txz",   36,  -90,  90,  "txz"));
+      r.Set(AxisSpec("tyz",   36,  -90,  90,  "txy"));
+      r.Set(AxisSpec("dqdx", 1000,   0, 3000, "dqdx"));
+      r.Set(AxisSpec("Q",    1000,   0, 3000, "Q"));
+      r.Set(AxisSpec("W",    1600,   0,  16,  "W"));
+      r.Set(AxisSpec("G",     500,   0, 100,  "G"));
+      r.Set(AxisSpec("P",       2,   0,   2,  "P"));
+      return r;
+    }
+
+    // Add or replace by name (a new name gets the next dim code)
+    void Set(const AxisSpec& a) {
+      for (auto& b : fAxes) {
+        if (b.name == a.name) {
+          b = a;
+          return;
+        }
+      }
+      fAxes.push_back(a);
+    }
+
+    void SetBins(const std::string& name, int nbins) {
+      for (auto& b : fAxes) {
+        if (b.name == name) b = AxisSpec(b.name, nbins, b.xmin, b.xmax, b.title);
+      }
+    }
+
+    bool Load(const std::string& path) {
+      std::ifstream in(path);
+      if (!in) {
+        std::cerr << "AxisRegistry: could not open " << path << std::endl;
+        return false;
+      }
+      std::string line;
+      int n = 0;
+      while (std::getline(in, line)) {
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.resize(hash);
+        std::istringstream ss(line);
+        std::string name, title;
+        int nbins;
+        double lo, hi;
+        if (!(ss >> name)) continue;
+        if (!(ss >> nbins >> lo >> hi) || nbins <= 0 || !(hi > lo)) {
+          std::cerr << "AxisRegistry: bad axis line in " << path << ": " << line << std::endl;
+          return false;
+        }
+        std::getline(ss >> std::ws, title);
+        Set(AxisSpec(name, nbins, lo, hi, title));
+        n++;
+      }
+      printf("AxisRegistry: %d axes from %s\n", n, path.c_str());
+      return true;
+    }
+
+    // The filler's defaults with $WIREMOD_AXES/<filler>.txt on top, if present
+    static AxisRegistry FromEnv(const std::string& filler, AxisRegistry r = Default()) {
+      const char* dir = getenv("WIREMOD_AXES");
+      if (!dir || !*dir) return r;
+      struct stat st;
+      if (stat(dir, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        std::cerr << "AxisRegistry: WIREMOD_AXES=" << dir << " is not a directory (one <filler>.txt per filler) --> default axes" << std::endl;
+        return r;
+      }
+      std::string path = std::string(dir) + "/" + filler + ".txt";
+      if (stat(path.c_str(), &st) == 0) r.Load(path);
+      return r;
+    }
+
+    int Code(const std::string& name) const {
+      for (size_t i = 0; i < fAxes.size(); i++) {
+        if (fAxes[i].name == name) return i;
+      }
+      return -1;
+    }
+
+    // Dim codes of a histogram: all known to the registry and below nvalues,
+    // the number of codes the filler computes a value for
+    bool Check(const std::vector<int>& dims, int nvalues, const std::string& filler) const {
+      for (int d : dims) {
+        if (d < 0 || d >= (int)fAxes.size() || d >= nvalues) {
+          std::cerr << "AxisRegistry: " << filler << " has no dim code " << d;
+          if (d >= 0 && d < (int)fAxes.size()) std::cerr << " (axis " << fAxes[d].name << ")";
+          std::cerr << ", codes 0-" << nvalues - 1 << ":";
+          for (int k = 0; k < nvalues && k < (int)fAxes.size(); k++) std::cerr << " " << fAxes[k].name;
+          std::cerr << std::endl;
+          return false;
+        }
+      }
+      return true;
+    }
+
+    size_t Size() const { return fAxes.size(); }
+    const AxisSpec& operator[](size_t code) const { return fAxes[code]; }
+
+    // Axes of a histogram by dim code; empty set on an unknown code
+    AxisSet Select(const std::vector<int>& dims) const {
+      std::vector<AxisSpec> sel;
+      for (int d : dims) {
+        if (d < 0 || d >= (int)fAxes.size()) {
+          std::cerr << "AxisRegistry: no axis with dim code " << d << std::endl;
+          return AxisSet();
+        }
+        sel.push_back(fAxes[d]);
+      }
+      return AxisSet(sel);
+    }
+
+  private:
+
+    std::vector<AxisSpec> fAxes;
+
+};
+
+#endif
@@ -0,0 +1,286 @@
+#ifndef CALIB_BUNDLE_H
+#define CALIB_BUNDLE_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <ctime>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "FitCache.h"
+#include "YZTable.h"
+#include "elifetime.h"
+
+
+/*
+
+  Prebuilt calibration bundle
+
+  One binary file holding the calibration inputs a filler needs, laid out so
+  it can be memory mapped and used in place:
+
+    CalibBundleHeader                      magic, version, isData, checksum
+    CalibBundleSection[nsections]          name, offset, size, count
+    payloads, each 64 byte aligned
+
+  Sections:
+    "yz_table"     float[YZTable::kNTotal]  [plane][tpc][z][y], used in place by YZTable::Attach
+    "elife"        double[3]                tau_tpc0, tau_tpc1 (ms), v_drift (cm/ms)
+    "elife_runs"   CalibBundleRunTau[n]     per-run lifetimes (optional)
+    "calib_const"  float[3]                 my_calib_const_corr per plane
+
+  The mapping is read-only and shared (MAP_SHARED), so all jobs on one node
+  share the same pages through the page cache. Build bundles with
+  macros/Calib/make_calib_bundle.C. The SCE maps are not included: they are
+  owned by SCECorr and still read through SCECorr::ReadHistograms().
+
+*/
+
+const char kCalibBundleMagic[8] = { 'W', 'M', 'C', 'A', 'L', 'I', 'B', '\0' };
+const uint32_t kCalibBundleVersion = 1;
+
+struct CalibBundleHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t nsections;
+  uint32_t is_data;
+  uint32_t reserved;
+  uint64_t created;       // unix time
+  uint64_t payload_hash;  // FNV-1a over all payloads (FitCache::HashBytes)
+  char description[224];  // source files, for the job log
+};
+
+struct CalibBundleSection {
+  char name[32];
+  uint64_t offset;  // from the start of the file
+  uint64_t size;    // bytes
+  uint64_t count;   // elements
+};
+
+struct CalibBundleRunTau {
+  int32_t run;
+  int32_t pad;
+  double tau[2];
+};
+
+
+class CalibBundleWriter {
+
+  public:
+
+    CalibBundleWriter(bool isData, const std::string& description = "")
+      : fIsData(isData), fDescription(description) {}
+
+    void Add(const std::string& name, const void* data, size_t size, size_t count) {
+      Section s;
+      s.name = name;
+      s.bytes.assign((const char*)data, (const char*)data + size);
+      s.count = count;
+      fSections.push_back(s);
+    }
+
+    bool Write(const std::string& path) const {
+      const size_t kAlign = 64;
+      size_t offset = sizeof(CalibBundleHeader) + fSections.size() * sizeof(CalibBundleSection);
+      std::vector<CalibBundleSection> table(fSections.size());
+      uint64_t hash = 14695981039346656037ULL;
+      for (size_t i = 0; i < fSections.size(); i++) {
+        offset = (offset + kAlign - 1) / kAlign * kAlign;
+        std::memset(&table[i], 0, sizeof(CalibBundleSection));
+        std::strncpy(table[i].name, fSections[i].name.c_str(), sizeof(table[i].name) - 1);
+        table[i].offset = offset;
+        table[i].size = fSections[i].bytes.size();
+        table[i].count = fSections[i].count;
+        hash = FitCache::HashBytes(fSections[i].bytes.data(), fSections[i].bytes.size(), hash);
+        offset += fSections[i].bytes.size();
+      }
+
+      CalibBundleHeader header;
+      std::memset(&header, 0, sizeof(header));
+      std::memcpy(header.magic, kCalibBundleMagic, sizeof(header.magic));
+      header.version = kCalibBundleVersion;
+      header.nsections = fSections.size();
+      header.is_data = fIsData;
+      header.created = (uint64_t)time(nullptr);
+      header.payload_hash = hash;
+      std::strncpy(header.description, fDescription.c_str(), sizeof(header.description) - 1);
+
+      std::ofstream out(path, std::ios::binary);
+      if (!out) {
+        std::cerr << "CalibBundle: could not create " << path << std::endl;
+        return false;
+      }
+      out.write((const char*)&header, sizeof(header));
+      out.write((const char*)table.data(), table.size() * sizeof(CalibBundleSection));
+      size_t pos = sizeof(header) + table.size() * sizeof(CalibBundleSection);
+      for (size_t i = 0; i < fSections.size(); i++) {
+        std::vector<char> pad(table[i].offset - pos, 0);
+        out.write(pad.data(), pad.size());
+        out.write(fSections[i].bytes.data(), fSections[i].bytes.size());
+        pos = table[i].offset + table[i].size;
+      }
+      printf("CalibBundle: wrote %zu sections (%zu bytes) to %s\n", fSections.size(), pos, path.c_str());
+      return (bool)out;
+    }
+
+  private:
+
+    struct Section {
+      std::string name;
+      std::vector<char> bytes;
+      size_t count;
+    };
+
+    bool fIsData;
+    std::string fDescription;
+    std::vector<Section> fSections;
+
+};
+
+
+class CalibBundle {
+
+  public:
+
+    CalibBundle() {}
+    ~CalibBundle() { Close(); }
+
+    CalibBundle(const CalibBundle&) = delete;
+    CalibBundle& operator=(const CalibBundle&) = delete;
+
+    // verify = true checks the payload hash (reads every page once)
+    bool Open(const std::string& path, bool verify = true) {
+      Close();
+      int fd = open(path.c_str(), O_RDONLY);
+      if (fd < 0) {
+        std::cerr << "CalibBundle: could not open " << path << std::endl;
+        return false;
+      }
+      struct stat st;
+      if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CalibBundleHeader)) {
+        std::cerr << "CalibBundle: " << path << " is too small" << std::endl;
+        close(fd);
+        return false;
+      }
+      void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      close(fd);
+      if (p == MAP_FAILED) {
+        std::cerr << "CalibBundle: mmap of " << path << " failed" << std::endl;
+        return false;
+      }
+      fBase = (const char*)p;
+      fSize = st.st_size;
+      madvise(p, fSize, MADV_WILLNEED);
+
+      const CalibBundleHeader* h = Header();
+      if (std::memcmp(h->magic, kCalibBundleMagic, sizeof(h->magic)) != 0 || h->version != kCalibBundleVersion) {
+        std::cerr << "CalibBundle: " << path << " is not a version " << kCalibBundleVersion << " bundle" << std::endl;
+        Close();
+        return false;
+      }
+      if (sizeof(CalibBundleHeader) + h->nsections * sizeof(CalibBundleSection) > fSize) {
+        std::cerr << "CalibBundle: " << path << " has a truncated section table" << std::endl;
+        Close();
+        return false;
+      }
+      uint64_t hash = 14695981039346656037ULL;
+      for (uint32_t i = 0; i < h->nsections; i++) {
+        const CalibBundleSection& s = Sections()[i];
+        if (s.offset + s.size > fSize) {
+          std::cerr << "CalibBundle: section " << s.name << " of " << path << " is truncated" << std::endl;
+          Close();
+          return false;
+        }
+        if (verify) hash = FitCache::HashBytes(fBase + s.offset, s.size, hash);
+      }
+      if (verify && hash != h->payload_hash) {
+        std::cerr << "CalibBundle: checksum mismatch in " << path << std::endl;
+        Close();
+        return false;
+      }
+      fPath = path;
+      return true;
+    }
+
+    void Close() {
+      if (fBase) munmap((void*)fBase, fSize);
+      fBase = nullptr;
+      fSize = 0;
+    }
+
+    bool IsOpen() const { return fBase != nullptr; }
+    bool IsData() const { return Header()->is_data; }
+
+    // Payload of a section, nullptr if missing or smaller than min_count elements
+    template <typename T>
+    const T* Get(const char* name, size_t min_count = 1, size_t* count = nullptr) const {
+      if (!fBase) return nullptr;
+      for (uint32_t i = 0; i < Header()->nsections; i++) {
+        const CalibBundleSection& s = Sections()[i];
+        if (std::strncmp(s.name, name, sizeof(s.name)) != 0) continue;
+        if (s.count < min_count || s.size < s.count * sizeof(T)) return nullptr;
+        if (count) *count = s.count;
+        return (const T*)(fBase + s.offset);
+      }
+      return nullptr;
+    }
+
+    // Point the YZ table at the mapped maps
+    bool AttachYZ(YZTable* table) const {
+      const float* yz = Get<float>("yz_table", YZTable::kNTotal);
+      if (!yz) return false;
+      table->Attach(yz);
+      return true;
+    }
+
+    // Lifetimes and per-run lifetimes
+    bool ConfigureLifetime(LifetimeCorr* elife) const {
+      const double* e = Get<double>("elife", 3);
+      if (!e) return false;
+      elife->SetVDrift(e[2]);
+      elife->Configure(e[0], e[1]);
+      size_t nruns = 0;
+      const CalibBundleRunTau* runs = Get<CalibBundleRunTau>("elife_runs", 1, &nruns);
+      for (size_t i = 0; runs && i < nruns; i++) elife->SetRunTau(runs[i].run, runs[i].tau[0], runs[i].tau[1]);
+      return true;
+    }
+
+    // Calibration constant correction of a plane (1 if missing)
+    float CalibConst(int plane) const {
+      const float* c = Get<float>("calib_const", 3);
+      return (c && plane >= 0 && plane < 3) ? c[plane] : 1.f;
+    }
+
+    void Print() const {
+      if (!fBase) return;
+      const CalibBundleHeader* h = Header();
+      time_t created = h->created;
+      printf("CalibBundle: %s (v%u, %s, created %s", fPath.c_str(), h->version, h->is_data ? "data" : "mc", ctime(&created));
+      printf("  %s\n", h->description);
+      for (uint32_t i = 0; i < h->nsections; i++) {
+        const CalibBundleSection& s = Sections()[i];
+        printf("  %-12s %10llu bytes %8llu entries\n", s.name, (unsigned long long)s.size, (unsigned long long)s.count);
+      }
+    }
+
+  private:
+
+    const CalibBundleHeader* Header() const { return (const CalibBundleHeader*)fBase; }
+    const CalibBundleSection* Sections() const {
+      return (const CalibBundleSection*)(fBase + sizeof(CalibBundleHeader));
+    }
+
+    const char* fBase = nullptr;
+    size_t fSize = 0;
+    std::string fPath;
+
+};
+
+#endif
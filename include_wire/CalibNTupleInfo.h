@@ -4,9 +4,12 @@
 // Standard Library Includes
 #include <iostream>
 #include <fstream>
+#include <vector>
+#include <string>
 
 // ROOT Includes
 #include "TTree.h"
+#include "TString.h"
 #include "TObject.h"
 #include "TVector3.h"
 
@@ -141,6 +144,34 @@ struct MyCalib {
 	  }
 
 	  {}
+
+    // Restrict the reader to the chain entries [first, last), last < 0 = to the end.
+    // Entry numbers are global over the chain, see grid/plan_shards.py
+    bool SetEntryRange(Long64_t first, Long64_t last) {
+      if (first <= 0 && last < 0) return true;
+      if (reader.SetEntriesRange(first, last < 0 ? -1 : last) != TTreeReader::kEntryValid) {
+        std::cerr << "MyCalib: invalid entry range [" << first << ", " << last << ")" << std::endl;
+        return false;
+      }
+      std::cout << "Entry range: [" << first << ", " << (last < 0 ? TString("end") : TString::LLtoa(last, 10)) << ")" << std::endl;
+      return true;
+    }
+
+    // Branches read through the reader, for the TTreeCache (ChainIO.h)
+    std::vector<std::string> BranchNames() const {
+      std::vector<std::string> names = {
+        run.GetBranchName(), subrun.GetBranchName(), evt.GetBranchName(),
+        selected.GetBranchName(), whicht0.GetBranchName(),
+        trk_dirx.GetBranchName(), trk_diry.GetBranchName(), trk_dirz.GetBranchName()
+      };
+      for (UInt_t ip = 0; ip < kNplanes; ip++) {
+        for (const ROOT::Internal::TTreeReaderValueBase* b : std::vector<const ROOT::Internal::TTreeReaderValueBase*>{
+               &tpc[ip], &goodness[ip], &mult[ip], &x[ip], &y[ip], &z[ip], &width[ip], &integral[ip],
+               &ontraj[ip], &dirx[ip], &diry[ip], &dirz[ip], &dqdx[ip], &rr[ip] })
+          names.push_back(b->GetBranchName());
+      }
+      return names;
+    }
 };
 
 #endif
@@ -54,15 +54,20 @@ XYZVector apply_sce_std(SCECorr *sce_corr, float &corr, int plane, const XYZVect
 }
 
 
+// Note: May need to update the maps in the future 
+TString yz_map_file(bool isData)
+{
+  TString yz_corr_f = "yz_correction_map_data1e20.root";
+  if(!isData) yz_corr_f = "yz_correction_map_mcp2025b5e18.root";
+  return yz_corr_f;
+}
+
 void initialize_yz(YZCorr *yz_corr, bool isData) 
 
 {
   //TString datapath = getenv("SBND_YZCORR_PATH");
   //std::cout << "YZ Map Path " << datapath << std::endl;  
-  // Note: May need to update the maps in the future 
-  TString yz_corr_f = "yz_correction_map_data1e20.root";
-  if(!isData) yz_corr_f = "yz_correction_map_mcp2025b5e18.root";
-  yz_corr -> SetFileStr(yz_corr_f);
+  yz_corr -> SetFileStr(yz_map_file(isData));
 
 }
 
@@ -0,0 +1,120 @@
+#ifndef CHAIN_IO_H
+#define CHAIN_IO_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+
+#include "TChain.h"
+#include "TFile.h"
+#include "TString.h"
+#include "TTreeCache.h"
+#include "TTreePerfStats.h"
+
+
+/*
+
+  TTreeCache setup and read statistics for the ntuple chain
+
+  By default every basket of every branch the reader touches is a separate
+  read, which over xrootd means one round trip per basket. ChainIO sizes the
+  TTreeCache, registers exactly the branches the reader uses (MyCalib::
+  BranchNames()) and keeps a short learning phase on top, so branches read
+  implicitly (collection sizes of split vectors) are picked up as well. With
+  cluster prefetching the next cluster is requested while the current one is
+  being processed. The cache travels with the chain from file to file.
+
+  Environment:
+    WIREMOD_TREECACHE_MB=N      cache size (default 100, 0 = no cache)
+    WIREMOD_TREECACHE_LEARN=N   learning entries on top of the branch list (default 10)
+    WIREMOD_PREFETCH=0          disable cluster prefetching
+    WIREMOD_IOPERF=file.root    also record TTreePerfStats and save them
+
+  Report() prints read calls, bytes read, throughput and cache efficiency for
+  the job. The counters are the global TFile ones, so they cover exactly this
+  job's reads in a one filler per process setup. Local files give the same
+  call counts as remote ones, see macros/Bench/bench_chain_io.C.
+
+*/
+
+inline long env_long(const char* name, long def) {
+  const char* v = getenv(name);
+  return (v && *v) ? atol(v) : def;
+}
+
+
+class ChainIO {
+
+  public:
+
+    ChainIO(TChain* chain) : fChain(chain) {}
+
+    ~ChainIO() { delete fPerf; }
+
+    // Call after the reader is built, before the first entry
+    void Setup(const std::vector<std::string>& branches) {
+      fStart = std::chrono::steady_clock::now();
+      fCalls0 = TFile::GetFileReadCalls();
+      fBytes0 = TFile::GetFileBytesRead();
+
+      long cache_mb = env_long("WIREMOD_TREECACHE_MB", 100);
+      long learn = env_long("WIREMOD_TREECACHE_LEARN", 10);
+      fPrefetch = env_long("WIREMOD_PREFETCH", 1) != 0;
+
+      if (getenv("WIREMOD_IOPERF")) fPerf = new TTreePerfStats("ioperf", fChain);
+
+      if (cache_mb <= 0) {
+        fChain->SetCacheSize(0);
+        printf("ChainIO: TTreeCache disabled\n");
+        return;
+      }
+      fChain->SetCacheSize(cache_mb * 1024 * 1024);
+      fChain->SetCacheLearnEntries(learn > 0 ? learn : 1);
+      if (fChain->LoadTree(0) < 0) return;
+      int nadded = 0;
+      for (const auto& b : branches) {
+        if (fChain->AddBranchToCache(b.c_str(), true) == 0) nadded++;
+        else std::cerr << "ChainIO: branch " << b << " not found for the cache" << std::endl;
+      }
+      if (learn <= 0) fChain->StopCacheLearningPhase();
+      fChain->SetClusterPrefetch(fPrefetch);
+      fCached = true;
+      printf("ChainIO: TTreeCache %ld MB, %d/%zu branches, learning %ld entries, prefetch %s\n",
+             cache_mb, nadded, branches.size(), learn, fPrefetch ? "on" : "off");
+    }
+
+    Int_t ReadCalls() const { return TFile::GetFileReadCalls() - fCalls0; }
+    Long64_t BytesRead() const { return TFile::GetFileBytesRead() - fBytes0; }
+
+    void Report() const {
+      double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - fStart).count();
+      double mb = BytesRead() / (1024. * 1024.);
+      printf("ChainIO: %d read calls, %.1f MB read (%.1f kB/call) in %.1f s, %.1f MB/s\n",
+             ReadCalls(), mb, ReadCalls() > 0 ? 1024. * mb / ReadCalls() : 0., sec, sec > 0 ? mb / sec : 0.);
+      if (fCached && fChain->GetCurrentFile()) {
+        TTreeCache* tc = dynamic_cast<TTreeCache*>(fChain->GetReadCache(fChain->GetCurrentFile()));
+        if (tc) printf("ChainIO: cache efficiency %.3f (relative %.3f), %d branches in the cache\n",
+                       tc->GetEfficiency(), tc->GetEfficiencyRel(), tc->GetCachedBranches() ? tc->GetCachedBranches()->GetEntries() : 0);
+      }
+      if (fPerf) {
+        fPerf->Finish();
+        fPerf->Print();
+        fPerf->SaveAs(getenv("WIREMOD_IOPERF"));
+      }
+    }
+
+  private:
+
+    TChain* fChain;
+    TTreePerfStats* fPerf = nullptr;
+    bool fCached = false;
+    bool fPrefetch = true;
+    Int_t fCalls0 = 0;
+    Long64_t fBytes0 = 0;
+    std::chrono::steady_clock::time_point fStart;
+
+};
+
+#endif
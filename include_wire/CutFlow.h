@@ -0,0 +1,170 @@
+#ifndef CUT_FLOW_H
+#define CUT_FLOW_H
+
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+
+#include "TH1D.h"
+#include "TH2D.h"
+
+#include "HitSelection.h"
+
+
+/*
+
+  Cut-flow counters for the fillers
+
+  Track level: the number of tracks removed by each selection, in the order the
+  filler applies them.
+  Hit level, per plane/TPC (idx = plane + 3*tpc):
+    - first: the first cut a hit fails (same order as the old hit loop), which
+             is the classic cut flow
+    - any:   every cut a hit fails, independent of order. Cuts that reject
+             many hits on their own are worth moving to the front.
+
+  The hit counters come straight from the HitMask bits, so the cost in the hot
+  loop is a couple of integer ops per hit. Counters are plain integers: each
+  thread keeps its own CutFlow and they are combined with Merge().
+  Write() stores them as histograms so they hadd/merge with the rest.
+
+*/
+
+enum TrackCut {
+  kTrkAll = 0,    // tracks read
+  kTrkLifeSel,    // life_sel: not an anode-cathode crosser
+  kTrkSelected,   // selected < 1
+  kTrkTPCT0,      // tpc_sel: whicht0 != 0
+  kTrkCRTT0,      // crt_sel: whicht0 == 0
+  kTrkNoHits,     // no collection hits
+  kTrkLength,     // rr cut (kTrackCut)
+  kTrkPassed,     // tracks entering the hit loop
+  kNTrackCuts
+};
+
+const char* const kTrackCutNames[kNTrackCuts] = {
+  "all", "life_sel", "selected", "tpc_t0", "crt_t0", "no_hits", "length", "passed"
+};
+
+
+class CutFlow {
+
+  public:
+
+    static const int kNIdx = 6; // kNplanes * kNTPCs
+
+    CutFlow() { Reset(); }
+
+    void Reset() {
+      std::memset(fTrack, 0, sizeof(fTrack));
+      std::memset(fFirst, 0, sizeof(fFirst));
+      std::memset(fAny, 0, sizeof(fAny));
+      std::memset(fTotal, 0, sizeof(fTotal));
+    }
+
+    inline void Track(TrackCut c) { fTrack[c]++; }
+    inline void Track(TrackCut c, uint64_t n) { fTrack[c] += n; }
+
+    // All hits of one plane after HitMask::Build
+    inline void Hits(unsigned ip, const PlaneHits& hits, const HitMask& mask) {
+      Hits(ip, hits, mask, mask.RejectMask());
+    }
+
+    // Same with another reject mask on the bits of mask
+    inline void Hits(unsigned ip, const PlaneHits& hits, const HitMask& mask, uint16_t reject) {
+      const std::vector<uint16_t>& fails = mask.Fails();
+      for (size_t i = 0; i < hits.n; i++) {
+        unsigned idx = ip + 3 * (hits.tpc[i] != 0);
+        uint16_t f = fails[i] & reject;
+        fTotal[idx]++;
+        // lowest set bit = first cut in the filler order; kNHitCuts = accepted
+        fFirst[idx][f ? __builtin_ctz(f) : kNHitCuts]++;
+        for (uint16_t b = f; b; b &= b - 1) fAny[idx][__builtin_ctz(b)]++;
+      }
+    }
+
+    void Merge(const CutFlow& o) {
+      for (int c = 0; c < kNTrackCuts; c++) fTrack[c] += o.fTrack[c];
+      for (int i = 0; i < kNIdx; i++) {
+        fTotal[i] += o.fTotal[i];
+        for (int c = 0; c <= kNHitCuts; c++) fFirst[i][c] += o.fFirst[i][c];
+        for (int c = 0; c < kNHitCuts; c++) fAny[i][c] += o.fAny[i][c];
+      }
+    }
+
+    // Takes back the counts of o (counted earlier into this one)
+    void Remove(const CutFlow& o) {
+      for (int c = 0; c < kNTrackCuts; c++) fTrack[c] -= o.fTrack[c];
+      for (int i = 0; i < kNIdx; i++) {
+        fTotal[i] -= o.fTotal[i];
+        for (int c = 0; c <= kNHitCuts; c++) fFirst[i][c] -= o.fFirst[i][c];
+        for (int c = 0; c < kNHitCuts; c++) fAny[i][c] -= o.fAny[i][c];
+      }
+    }
+
+    void Print() const {
+      printf("------------------------- Cut Flow -------------------------\n");
+      printf("Tracks:\n");
+      for (int c = 0; c < kNTrackCuts; c++) {
+        printf("  %-14s %12llu\n", kTrackCutNames[c], (unsigned long long)fTrack[c]);
+      }
+      printf("Hits (first failing cut / any failing cut) per plane+3*tpc:\n");
+      printf("  %-14s", "cut");
+      for (int i = 0; i < kNIdx; i++) printf("        idx %d        ", i);
+      printf("\n  %-14s", "total");
+      for (int i = 0; i < kNIdx; i++) printf(" %20llu", (unsigned long long)fTotal[i]);
+      printf("\n");
+      for (int c = 0; c < kNHitCuts; c++) {
+        printf("  %-14s", kHitCutNames[c]);
+        for (int i = 0; i < kNIdx; i++) {
+          printf(" %9llu/%-10llu", (unsigned long long)fFirst[i][c], (unsigned long long)fAny[i][c]);
+        }
+        printf("\n");
+      }
+      printf("  %-14s", "accepted");
+      for (int i = 0; i < kNIdx; i++) printf(" %20llu", (unsigned long long)fFirst[i][kNHitCuts]);
+      printf("\n------------------------------------------------------------\n");
+    }
+
+    // hCutFlowTracks, hCutFlowHits (first failing cut) and hCutFlowHitsAny
+    void Write() const {
+      TH1D* ht = new TH1D("hCutFlowTracks", "Track cut flow", kNTrackCuts, 0, kNTrackCuts);
+      for (int c = 0; c < kNTrackCuts; c++) {
+        ht->GetXaxis()->SetBinLabel(c + 1, kTrackCutNames[c]);
+        ht->SetBinContent(c + 1, fTrack[c]);
+      }
+
+      TH2D* hf = new TH2D("hCutFlowHits", "Hit cut flow (first failing cut);cut;plane + 3*tpc",
+                          kNHitCuts + 2, 0, kNHitCuts + 2, kNIdx, 0, kNIdx);
+      TH2D* ha = new TH2D("hCutFlowHitsAny", "Hits failing each cut;cut;plane + 3*tpc",
+                          kNHitCuts, 0, kNHitCuts, kNIdx, 0, kNIdx);
+      for (int c = 0; c < kNHitCuts; c++) {
+        hf->GetXaxis()->SetBinLabel(c + 1, kHitCutNames[c]);
+        ha->GetXaxis()->SetBinLabel(c + 1, kHitCutNames[c]);
+      }
+      hf->GetXaxis()->SetBinLabel(kNHitCuts + 1, "accepted");
+      hf->GetXaxis()->SetBinLabel(kNHitCuts + 2, "total");
+      for (int i = 0; i < kNIdx; i++) {
+        for (int c = 0; c <= kNHitCuts; c++) hf->SetBinContent(c + 1, i + 1, fFirst[i][c]);
+        hf->SetBinContent(kNHitCuts + 2, i + 1, fTotal[i]);
+        for (int c = 0; c < kNHitCuts; c++) ha->SetBinContent(c + 1, i + 1, fAny[i][c]);
+      }
+
+      ht->Write();
+      hf->Write();
+      ha->Write();
+      delete ht;
+      delete hf;
+      delete ha;
+    }
+
+  private:
+
+    uint64_t fTrack[kNTrackCuts];
+    uint64_t fFirst[kNIdx][kNHitCuts + 1];
+    uint64_t fAny[kNIdx][kNHitCuts];
+    uint64_t fTotal[kNIdx];
+
+};
+
+#endif
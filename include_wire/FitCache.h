@@ -0,0 +1,158 @@
+// Persistent, content-addressed cache for slice fit / ITM results
+#ifndef FIT_CACHE_H
+#define FIT_CACHE_H
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstring>
+
+#include "TH1.h"
+
+
+/*
+
+  Results are keyed by a 64 bit FNV-1a hash of everything that determines the
+  outcome of a slice fit:
+    - the slice histogram (binning, contents and errors incl. under/overflow)
+    - the fit model tag (e.g. "langau", "itm_std_err(-2,1.75,1e-4)")
+    - the fit range, start values and parameter limits
+
+  If nothing upstream changed, a rerun gets a cache hit and skips the fit.
+  The cache file is plain text, one entry per line:  <hash> <nvals> v0 v1 ...
+
+*/
+
+class FitCache {
+
+  public:
+
+    FitCache(const std::string& path) : fPath(path) { Load(); }
+    ~FitCache() { Save(); }
+
+    // ---------------- Hashing ---------------- //
+
+    static uint64_t HashBytes(const void* data, size_t n, uint64_t h = 14695981039346656037ULL) {
+      const unsigned char* p = static_cast<const unsigned char*>(data);
+      for (size_t i = 0; i < n; ++i) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+      }
+      return h;
+    }
+
+    static uint64_t HashDoubles(const double* vals, size_t n, uint64_t h) {
+      return HashBytes(vals, n * sizeof(double), h);
+    }
+
+    static uint64_t HashString(const std::string& s, uint64_t h) {
+      return HashBytes(s.data(), s.size(), h);
+    }
+
+    static uint64_t HashHist(const TH1* h, uint64_t seed = 14695981039346656037ULL) {
+      Int_t nbins = h->GetNbinsX();
+      double axis[3] = { (double)nbins, h->GetXaxis()->GetXmin(), h->GetXaxis()->GetXmax() };
+      uint64_t out = HashDoubles(axis, 3, seed);
+      for (Int_t i = 0; i <= nbins + 1; ++i) {
+        double bin[2] = { h->GetBinContent(i), h->GetBinError(i) };
+        out = HashDoubles(bin, 2, out);
+      }
+      return out;
+    }
+
+    // Key for a fit of histogram h with a given model, range and parameter set
+    static uint64_t Key(const TH1* h, const std::string& model, const double* range, int nrange,
+                        const double* pars = nullptr, int npars = 0) {
+      uint64_t k = HashHist(h);
+      k = HashString(model, k);
+      if (range) k = HashDoubles(range, nrange, k);
+      if (pars) k = HashDoubles(pars, npars, k);
+      return k;
+    }
+
+    // ---------------- Lookup ---------------- //
+
+    bool Get(uint64_t key, double* vals, size_t n) {
+      auto it = fEntries.find(key);
+      if (it == fEntries.end() || it->second.size() != n) {
+        fMisses++;
+        return false;
+      }
+      std::memcpy(vals, it->second.data(), n * sizeof(double));
+      fHits++;
+      return true;
+    }
+
+    void Put(uint64_t key, const double* vals, size_t n) {
+      fEntries[key] = std::vector<double>(vals, vals + n);
+      fDirty = true;
+    }
+
+    // ---------------- Persistence ---------------- //
+
+    void Load() {
+      std::ifstream in(fPath);
+      if (!in) return;
+      std::string line;
+      while (std::getline(in, line)) {
+        std::istringstream ss(line);
+        uint64_t key;
+        size_t n;
+        if (!(ss >> std::hex >> key >> std::dec >> n)) continue;
+        std::vector<double> vals(n);
+        bool ok = true;
+        for (size_t i = 0; i < n; ++i) {
+          if (!(ss >> vals[i])) { ok = false; break; }
+        }
+        if (ok) fEntries[key] = vals;
+      }
+      std::cout << "FitCache: loaded " << fEntries.size() << " entries from " << fPath << std::endl;
+    }
+
+    void Save() {
+      if (!fDirty) return;
+      std::ofstream out(fPath, std::ios::trunc);
+      if (!out) {
+        std::cerr << "FitCache: could not write " << fPath << std::endl;
+        return;
+      }
+      out.precision(17);
+      for (const auto& [key, vals] : fEntries) {
+        out << std::hex << key << std::dec << " " << vals.size();
+        for (double v : vals) out << " " << v;
+        out << "\n";
+      }
+      fDirty = false;
+    }
+
+    void PrintSummary() const {
+      std::cout << "FitCache: " << fHits << " hits, " << fMisses << " misses ("
+                << fEntries.size() << " entries in " << fPath << ")" << std::endl;
+    }
+
+    size_t Hits() const { return fHits; }
+    size_t Misses() const { return fMisses; }
+
+  private:
+
+    std::string fPath;
+    std::unordered_map<uint64_t, std::vector<double>> fEntries;
+    size_t fHits = 0;
+    size_t fMisses = 0;
+    bool fDirty = false;
+
+};
+
+
+// Default cache location: next to the output file unless WIREMOD_FIT_CACHE is set
+std::string fit_cache_path(const char* output_file) {
+  const char* env = getenv("WIREMOD_FIT_CACHE");
+  if (env && *env) return std::string(env);
+  return std::string(output_file) + ".fitcache";
+}
+
+#endif
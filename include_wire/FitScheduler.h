@@ -0,0 +1,183 @@
+// Neighbour-seeded scheduling of Landau-Gaussian slice fits
+#ifndef FIT_SCHEDULER_H
+#define FIT_SCHEDULER_H
+
+#include <iostream>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <cmath>
+
+#include "TH1.h"
+
+#include "Fitting.h"
+
+
+/*
+
+  Adjacent slices of a profile (along x, theta-xz, ...) have nearly identical
+  Landau-Gaussian parameters. Instead of starting every slice from moment
+  guesses, the driver:
+    1) fits the slices in order of decreasing statistics
+    2) seeds each fit from the nearest already-converged neighbour
+       (area scaled by the integral ratio)
+    3) falls back to the moment guesses, and then to the "narrow gaus" guesses,
+       only when the seeded fit is bad (chi2/ndf above threshold)
+
+  With no converged neighbour the sequence is exactly the old one in
+  profile_smooth_1d_landau.C. The average number of Minuit calls per fit is
+  tracked so the speedup can be measured; fits served by the FitCache are
+  counted apart and left out of it.
+
+*/
+
+struct LangauSliceFit {
+    double fp[4] = {0., 0., 0., 0.};
+    double fpe[4] = {0., 0., 0., 0.};
+    double chisqr = 0.;
+    int ndf = 0;
+    bool converged = false;
+    bool seeded = false;   // accepted result came from a neighbour seed
+};
+
+
+class LangauSliceDriver {
+
+  public:
+
+    LangauSliceDriver(FitCache* cache = nullptr, double max_chi2ndf = 5., int max_dist = 3)
+      : fCache(cache), fMaxChi2NDF(max_chi2ndf), fMaxDist(max_dist) {}
+
+    std::vector<LangauSliceFit> Run(const std::vector<TH1D*>& slices) {
+
+      std::vector<LangauSliceFit> out(slices.size());
+
+      // highest statistics first
+      std::vector<size_t> order(slices.size());
+      std::iota(order.begin(), order.end(), 0);
+      std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return Entries(slices[a]) > Entries(slices[b]);
+      });
+
+      for (size_t n : order) {
+        TH1D* h = slices[n];
+        if (Entries(h) <= 0) continue;
+        fNSlices++;
+
+        LangauSliceFit& res = out[n];
+
+        // 1) seed from the nearest converged neighbour
+        int nb = Neighbour(out, slices, n);
+        if (nb >= 0) {
+          double fr[2], sv[4];
+          Range(h, 0.04, 0.9, fr);
+          double scale = slices[nb]->Integral() > 0 ? h->Integral() / slices[nb]->Integral() : 1.;
+          sv[0] = out[nb].fp[0];
+          sv[1] = out[nb].fp[1];
+          sv[2] = out[nb].fp[2] * scale;
+          sv[3] = out[nb].fp[3];
+          Clamp(sv);
+          if (Fit(h, fr, sv, res)) {
+            res.seeded = true;
+            fNSeeded++;
+            continue;
+          }
+        }
+
+        // 2) moment based guesses
+        {
+          double fr[2], sv[4];
+          Range(h, 0.04, 0.9, fr);
+          sv[0] = h->GetRMS()/2; sv[1] = h->GetMean(); sv[2] = 50000.0; sv[3] = h->GetRMS()/2;
+          if (Fit(h, fr, sv, res)) continue;
+        }
+
+        // 3) probably a narrow gaus
+        std::cout << "Re-evaluate for a bad fit ..." << std::endl;
+        {
+          double fr[2], sv[4];
+          Range(h, 0.03, 0.9, fr);
+          sv[0] = h->GetRMS()/3; sv[1] = h->GetMean(); sv[2] = 50000.0; sv[3] = 0.1;
+          Fit(h, fr, sv, res);
+          fNFallback++;
+        }
+      }
+
+      return out;
+    }
+
+    void PrintSummary() const {
+      std::cout << "LangauSliceDriver: " << fNSlices << " slices, " << fNFits << " fits + " << fNCacheHits << " from the cache ("
+                << fNSeeded << " accepted from neighbour seeds, " << fNFallback << " narrow-gaus fallbacks)" << std::endl;
+      // cache hits run no Minuit, they would only dilute the averages
+      std::cout << "LangauSliceDriver: average Minuit calls per fit = "
+                << (fNFits ? (double)fNCalls / fNFits : 0.) << ", per fitted slice = "
+                << (fNFittedSlices ? (double)fNCalls / fNFittedSlices : 0.) << std::endl;
+    }
+
+  private:
+
+    static double Entries(const TH1D* h) { return h ? h->GetEntries() : 0.; }
+
+    static void Range(TH1D* h, double qlo, double qhi, double* fr) {
+      const Double_t kQuantiles[2] = { qlo, qhi };
+      h->GetQuantiles(2, fr, kQuantiles);
+    }
+
+    void Clamp(double* sv) const {
+      for (int i = 0; i < 4; i++) sv[i] = std::min(std::max(sv[i], fLo[i]), fHi[i]);
+    }
+
+    // Nearest converged slice within fMaxDist bins, ties go to the larger sample
+    int Neighbour(const std::vector<LangauSliceFit>& out, const std::vector<TH1D*>& slices, size_t n) const {
+      for (int d = 1; d <= fMaxDist; d++) {
+        int best = -1;
+        for (int s : { -d, d }) {
+          int m = (int)n + s;
+          if (m < 0 || m >= (int)out.size() || !out[m].converged) continue;
+          if (best < 0 || Entries(slices[m]) > Entries(slices[best])) best = m;
+        }
+        if (best >= 0) return best;
+      }
+      return -1;
+    }
+
+    // Returns true if the fit is good enough to keep
+    bool Fit(TH1D* h, double* fr, double* sv, LangauSliceFit& res) {
+      double pllo[4], plhi[4];
+      std::copy(fLo, fLo + 4, pllo);
+      std::copy(fHi, fHi + 4, plhi);
+      int ncalls = 0;
+      cached_langaufit(fCache, h, fr, sv, pllo, plhi, res.fp, res.fpe, &res.chisqr, &res.ndf, &ncalls);
+      if (ncalls < 0) {
+        fNCacheHits++;
+      }
+      else {
+        fNFits++;
+        fNCalls += ncalls;
+        if (fLastFitted != fNSlices) fNFittedSlices++;
+        fLastFitted = fNSlices;
+      }
+      res.converged = (res.ndf > 0) && (res.chisqr / res.ndf <= fMaxChi2NDF);
+      return res.converged;
+    }
+
+    FitCache* fCache;
+    double fMaxChi2NDF;
+    int fMaxDist;
+
+    const double fLo[4] = { 0., 0., 1.0, 0. };
+    const double fHi[4] = { 1000, 2000, 10000000.0, 1000.0 };
+
+    size_t fNSlices = 0;
+    size_t fNFits = 0;
+    size_t fNCacheHits = 0;
+    size_t fNCalls = 0;
+    size_t fNFittedSlices = 0;  // slices with at least one fit not from the cache
+    size_t fLastFitted = 0;     // fNSlices of the last fit not from the cache
+    size_t fNSeeded = 0;
+    size_t fNFallback = 0;
+
+};
+
+#endif
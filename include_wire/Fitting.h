@@ -22,6 +22,8 @@
 #include "TObjArray.h"
 #include "Math/Vector3D.h"
 
+#include "FitCache.h"
+
 
 void hist_mean_unc(const TH1* h, Double_t tol, Double_t* result);
 void iterative_truncated_mean(TH1* h, Double_t sig_down, Double_t sig_up, Double_t tol, Double_t* result);
@@ -63,7 +65,7 @@ Double_t langaufun(Double_t *x, Double_t *par) {
 }
 
 
-TF1 *langaufit(TH1D *his, double *fitrange, double *startvalues, double *parlimitslo, double *parlimitshi, double *fitparams, double *fiterrors, double *ChiSqr, int *NDF)
+TF1 *langaufit(TH1D *his, double *fitrange, double *startvalues, double *parlimitslo, double *parlimitshi, double *fitparams, double *fiterrors, double *ChiSqr, int *NDF, int *NCalls = nullptr)
 {
    // Once again, here are the Landau * Gaussian parameters:
    //   par[0]=Width (scale) parameter of Landau density
@@ -81,6 +83,7 @@ TF1 *langaufit(TH1D *his, double *fitrange, double *startvalues, double *parlimi
    //   fiterrors[4]    returns the final fit errors
    //   ChiSqr          returns the chi square
    //   NDF             returns ndf
+   //   NCalls          returns the number of Minuit function calls (optional)
  
    int i;
 
@@ -101,7 +104,8 @@ TF1 *langaufit(TH1D *his, double *fitrange, double *startvalues, double *parlimi
       ffit->SetParLimits(i, parlimitslo[i], parlimitshi[i]);
    }
  
-   his->Fit(FunName,"RB0");   // fit within specified range, use ParLimits, do not plot
+   TFitResultPtr r = his->Fit(FunName,"RB0S");   // fit within specified range, use ParLimits, do not plot
+   if (NCalls) NCalls[0] = (r.Get()) ? (int)r->NCalls() : 0;
  
    ffit->GetParameters(fitparams);    // obtain fit parameters
    for (i=0; i<4; i++) {
@@ -460,6 +464,77 @@ void iterative_truncated_mean_poly3(TH1* h, Double_t sig_down, Double_t sig_up,
     return;
 }
 
+// ---------------- CACHED WRAPPERS ---------------------- //
+
+// Each wrapper falls through to the plain function when cache == nullptr.
+// The ITM start value is not part of the key, so result[] is zeroed on a miss
+// to keep the cached answer reproducible.
+
+void cached_itm_std_err(FitCache* cache, TH1* h, Double_t sig_down, Double_t sig_up, Double_t tol, Double_t* result) {
+    result[0] = 0.; result[1] = 0.;
+    if (!cache) {
+        iterative_truncated_mean_std_err(h, sig_down, sig_up, tol, result);
+        return;
+    }
+    double cfg[3] = { sig_down, sig_up, tol };
+    uint64_t key = FitCache::Key(h, "itm_std_err", cfg, 3);
+    if (cache->Get(key, result, 2)) return;
+    iterative_truncated_mean_std_err(h, sig_down, sig_up, tol, result);
+    cache->Put(key, result, 2);
+}
+
+void cached_itm_poly3(FitCache* cache, TH1* h, Double_t sig_down, Double_t sig_up, Double_t tol, Double_t* result) {
+    result[0] = 0.; result[1] = 0.;
+    if (!cache) {
+        iterative_truncated_mean_poly3(h, sig_down, sig_up, tol, result);
+        return;
+    }
+    double cfg[3] = { sig_down, sig_up, tol };
+    uint64_t key = FitCache::Key(h, "itm_poly3", cfg, 3);
+    if (cache->Get(key, result, 2)) return;
+    iterative_truncated_mean_poly3(h, sig_down, sig_up, tol, result);
+    cache->Put(key, result, 2);
+}
+
+// Same interface as langaufit. Returns nullptr on a cache hit (no TF1 is built),
+// the outputs fitparams/fiterrors/ChiSqr/NDF are always filled. NCalls is -1 on a hit,
+// so callers can tell it from a fit that returned no result (0).
+TF1 *cached_langaufit(FitCache* cache, TH1D *his, double *fitrange, double *startvalues, double *parlimitslo, double *parlimitshi, double *fitparams, double *fiterrors, double *ChiSqr, int *NDF, int *NCalls = nullptr)
+{
+    if (!cache) return langaufit(his, fitrange, startvalues, parlimitslo, parlimitshi, fitparams, fiterrors, ChiSqr, NDF, NCalls);
+
+    double pars[12];
+    for (int i = 0; i < 4; i++) {
+        pars[i] = startvalues[i];
+        pars[4 + i] = parlimitslo[i];
+        pars[8 + i] = parlimitshi[i];
+    }
+    uint64_t key = FitCache::Key(his, "langau", fitrange, 2, pars, 12);
+
+    // 4 params, 4 errors, chi2, ndf
+    double vals[10];
+    if (cache->Get(key, vals, 10)) {
+        for (int i = 0; i < 4; i++) {
+            fitparams[i] = vals[i];
+            fiterrors[i] = vals[4 + i];
+        }
+        ChiSqr[0] = vals[8];
+        NDF[0] = (int)vals[9];
+        if (NCalls) NCalls[0] = -1;
+        return nullptr;
+    }
+
+    TF1* ffit = langaufit(his, fitrange, startvalues, parlimitslo, parlimitshi, fitparams, fiterrors, ChiSqr, NDF, NCalls);
+    for (int i = 0; i < 4; i++) {
+        vals[i] = fitparams[i];
+        vals[4 + i] = fiterrors[i];
+    }
+    vals[8] = ChiSqr[0];
+    vals[9] = NDF[0];
+    cache->Put(key, vals, 10);
+    return ffit;
+}
+
 
 void profile_2d_proj(TH1D* h_out, const char* input_file, int dim, int tpc, int plane, int Ndim) {
     // Open the input file
@@ -502,7 +577,7 @@ void profile_2d_proj(TH1D* h_out, const char* input_file, int dim, int tpc, int
 
 }
 
-void profile_2d_proj_std_err(TH1D* h_out, const char* input_file, int dim, int tpc, int plane, int Ndim) {
+void profile_2d_proj_std_err(TH1D* h_out, const char* input_file, int dim, int tpc, int plane, int Ndim, FitCache* cache = nullptr) {
     // Open the input file
     TFile* rfile = TFile::Open(input_file);
     if (!rfile || rfile->IsZombie()) {
@@ -528,7 +603,7 @@ void profile_2d_proj_std_err(TH1D* h_out, const char* input_file, int dim, int t
         Float_t itm = 0.; // iterative truncated mean (ITM)
         Float_t itm_unc = 0.; // uncertainty of ITM
         Double_t itm_result[2];
-        iterative_truncated_mean_std_err(h_1d_temp, -2, 1.75, 1.0e-4, itm_result);
+        cached_itm_std_err(cache, h_1d_temp, -2, 1.75, 1.0e-4, itm_result);
         itm = itm_result[0];
         itm_unc = itm_result[1];
         h_out->SetBinContent(i, itm);
@@ -543,7 +618,7 @@ void profile_2d_proj_std_err(TH1D* h_out, const char* input_file, int dim, int t
 
 }
 
-void profile_2d_proj_poly3(TH1D* h_out, const char* input_file, int dim, int tpc, int plane, int Ndim) {
+void profile_2d_proj_poly3(TH1D* h_out, const char* input_file, int dim, int tpc, int plane, int Ndim, FitCache* cache = nullptr) {
     // Open the input file
     TFile* rfile = TFile::Open(input_file);
     if (!rfile || rfile->IsZombie()) {
@@ -570,7 +645,7 @@ void profile_2d_proj_poly3(TH1D* h_out, const char* input_file, int dim, int tpc
         Float_t itm_unc = 0.; // uncertainty of ITM
         Double_t itm_result[2];
         //iterative_truncated_mean_std_err(h_1d_temp, -2, 1.75, 1.0e-4, itm_result);
-        iterative_truncated_mean_poly3(h_1d_temp, -2, 1.75, 1.0e-4, itm_result);
+        cached_itm_poly3(cache, h_1d_temp, -2, 1.75, 1.0e-4, itm_result);
 	itm = itm_result[0];
         itm_unc = itm_result[1];
         h_out->SetBinContent(i, itm);
@@ -0,0 +1,249 @@
+#ifndef HIST_PYRAMID_H
+#define HIST_PYRAMID_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+
+#include "TString.h"
+#include "TDirectory.h"
+#include "TKey.h"
+#include "TH1D.h"
+#include "TH2D.h"
+#include "TProfile.h"
+#include "THnSparse.h"
+
+
+/*
+
+  Pre-aggregated coarse levels of the merged THnSparse ("coarse grain later")
+
+  The fillers bin as fine as possible; a coarse view (x in 10 cm, txz in 10
+  degree steps) then means projecting and rebinning the finest histogram. A
+  merged output can carry a pyramid next to each histogram:
+
+    pyramid/<name>_r2, pyramid/<name>_r4, ...
+
+  level r<f> groups f bins per axis (or the largest divisor of the axis bin
+  count below f, so every level covers exactly the same range and its bin
+  edges are edges of the finest binning). Each level is rebinned from the
+  previous one.
+
+  HistPyramid answers a projection for requested bin widths (and optional
+  ranges on the other axes) from the coarsest level whose bins still line up
+  with the request, then rebins the remaining factor. The result is the same
+  as projecting the finest histogram and rebinning it.
+
+  Written by merge_hists_grid.C (pyramid argument) or, for existing outputs,
+  macros/Merge/build_pyramid.C.
+
+*/
+
+class HistPyramid {
+
+  public:
+
+    static const char* Dir() { return "pyramid"; }
+
+    // Per axis group: the largest divisor of the bin count <= factor
+    static std::vector<Int_t> Groups(const THnBase* h, int factor) {
+      std::vector<Int_t> g(h->GetNdimensions(), 1);
+      for (int d = 0; d < h->GetNdimensions(); d++) {
+        int n = h->GetAxis(d)->GetNbins();
+        for (int f = std::min(factor, n); f >= 1; f--) {
+          if (n % f == 0) { g[d] = f; break; }
+        }
+      }
+      return g;
+    }
+
+    // Write the levels of h into dir/pyramid (factors ascending, e.g. {2, 4})
+    static void Write(const THnSparse* h, const std::vector<int>& factors, TDirectory* dir) {
+      TDirectory* pdir = dir->GetDirectory(Dir());
+      if (!pdir) pdir = dir->mkdir(Dir());
+      const THnSparse* prev = h;
+      int prev_factor = 1;
+      std::vector<Int_t> prev_groups(h->GetNdimensions(), 1);
+      std::vector<THnSparse*> owned;
+      for (int f : factors) {
+        if (f <= prev_factor) continue;
+        std::vector<Int_t> groups = Groups(h, f);
+        // rebin from the previous level where it divides, else from the base
+        bool from_prev = true;
+        std::vector<Int_t> step(groups.size());
+        for (size_t d = 0; d < groups.size(); d++) {
+          step[d] = groups[d] / prev_groups[d];
+          if (groups[d] % prev_groups[d] != 0) from_prev = false;
+        }
+        THnSparse* level = from_prev ? prev->Rebin(step.data()) : h->Rebin(groups.data());
+        level->SetName(Form("%s_r%d", h->GetName(), f));
+        pdir->WriteTObject(level, level->GetName(), "Overwrite");
+        printf("HistPyramid: %s level r%d, %lld filled bins\n", h->GetName(), f, level->GetNbins());
+        owned.push_back(level);
+        prev = level;
+        prev_factor = f;
+        prev_groups = groups;
+      }
+      for (THnSparse* l : owned) delete l;
+    }
+
+    // Base histogram <name> in dir and the levels found in dir/pyramid
+    HistPyramid(TDirectory* dir, const char* name) {
+      THnSparse* base = dynamic_cast<THnSparse*>(dir->Get(name));
+      if (!base) {
+        std::cerr << "HistPyramid: no THnSparse " << name << std::endl;
+        return;
+      }
+      fLevels.push_back(base);
+      fRanges.assign(base->GetNdimensions(), std::make_pair(0., 0.));
+      TDirectory* pdir = dir->GetDirectory(Dir());
+      if (!pdir) return;
+      TString prefix = TString(name) + "_r";
+      TIter next(pdir->GetListOfKeys());
+      while (TKey* key = (TKey*)next()) {
+        TString kname = key->GetName();
+        if (!kname.BeginsWith(prefix) || !TString(kname(prefix.Length(), kname.Length())).IsDigit()) continue;
+        THnSparse* level = dynamic_cast<THnSparse*>(key->ReadObj());
+        if (level && level->GetNdimensions() == base->GetNdimensions()) fLevels.push_back(level);
+      }
+      // coarsest first
+      std::stable_sort(fLevels.begin(), fLevels.end(), [](const THnSparse* a, const THnSparse* b) { return Cells(a) < Cells(b); });
+    }
+
+    ~HistPyramid() { for (THnSparse* l : fLevels) delete l; }
+
+    bool Valid() const { return !fLevels.empty(); }
+    size_t NLevels() const { return fLevels.size(); }
+    const THnSparse* Finest() const { return fLevels.back(); }
+
+    // Restrict an axis (lo < hi) for the next projections; lo == hi clears it
+    void SetRange(int axis, double lo, double hi) { fRanges[axis] = std::make_pair(lo, hi); }
+
+    // Projection on dims with the requested bin widths (0: finest); the
+    // result is owned by the caller
+    THnBase* Projection(const std::vector<int>& dims, const std::vector<double>& widths) {
+      std::vector<Int_t> rebin;
+      THnSparse* h = Pick(dims, widths, rebin);
+      if (!h) return nullptr;
+      ApplyRanges(h);
+      THnBase* p = h->ProjectionND(dims.size(), dims.data());
+      ClearRanges(h);
+      if (!Trivial(rebin)) {
+        THnBase* r = p->Rebin(rebin.data());
+        delete p;
+        p = r;
+      }
+      return p;
+    }
+
+    TH1D* Projection(int x, double wx = 0.) {
+      std::vector<Int_t> rebin;
+      THnSparse* h = Pick({ x }, { wx }, rebin);
+      if (!h) return nullptr;
+      ApplyRanges(h);
+      TH1D* p = h->Projection(x);
+      ClearRanges(h);
+      if (rebin[0] > 1) p->Rebin(rebin[0]);
+      return p;
+    }
+
+    // Same argument order as THnBase::Projection(ydim, xdim)
+    TH2D* Projection(int y, int x, double wy = 0., double wx = 0.) {
+      std::vector<Int_t> rebin;
+      THnSparse* h = Pick({ y, x }, { wy, wx }, rebin);
+      if (!h) return nullptr;
+      ApplyRanges(h);
+      TH2D* p = h->Projection(y, x);
+      ClearRanges(h);
+      if (rebin[0] > 1 || rebin[1] > 1) p->Rebin2D(rebin[1], rebin[0]);
+      return p;
+    }
+
+    // Mean of y per x bin
+    TProfile* Profile(int x, int y, double wx = 0., double wy = 0.) {
+      TH2D* h2 = Projection(y, x, wy, wx);
+      if (!h2) return nullptr;
+      TProfile* p = h2->ProfileX();
+      p->SetDirectory(0);
+      delete h2;
+      return p;
+    }
+
+    // Level used by the last projection (0 = coarsest)
+    int LastLevel() const { return fLast; }
+
+  private:
+
+    static double Cells(const THnSparse* h) {
+      double n = 1.;
+      for (int d = 0; d < h->GetNdimensions(); d++) n *= h->GetAxis(d)->GetNbins();
+      return n;
+    }
+
+    static bool Trivial(const std::vector<Int_t>& rebin) {
+      for (Int_t g : rebin) if (g > 1) return false;
+      return true;
+    }
+
+    // x on a bin edge of the axis (within rounding)
+    static bool OnEdge(const TAxis* ax, double x) {
+      double w = (ax->GetXmax() - ax->GetXmin()) / ax->GetNbins();
+      double u = (x - ax->GetXmin()) / w;
+      return std::fabs(u - std::round(u)) < 1e-6;
+    }
+
+    // Coarsest level whose bins divide the requested widths and whose edges
+    // match the requested ranges; rebin = what is left to group
+    THnSparse* Pick(const std::vector<int>& dims, const std::vector<double>& widths, std::vector<Int_t>& rebin) {
+      if (fLevels.empty()) return nullptr;
+      for (size_t l = 0; l < fLevels.size(); l++) {
+        THnSparse* h = fLevels[l];
+        bool ok = true;
+        rebin.assign(dims.size(), 1);
+        for (size_t i = 0; i < dims.size() && ok; i++) {
+          const TAxis* ax = h->GetAxis(dims[i]);
+          double w = (ax->GetXmax() - ax->GetXmin()) / ax->GetNbins();
+          const TAxis* fine = Finest()->GetAxis(dims[i]);
+          double wfine = (fine->GetXmax() - fine->GetXmin()) / fine->GetNbins();
+          double want = (widths[i] > 0) ? widths[i] : wfine;
+          double k = want / w;
+          int ik = (int)std::round(k);
+          if (ik < 1 || std::fabs(k - ik) > 1e-6 * k || ax->GetNbins() % ik != 0) ok = false;
+          else rebin[i] = ik;
+        }
+        for (size_t a = 0; a < fRanges.size() && ok; a++) {
+          if (!(fRanges[a].first < fRanges[a].second)) continue;
+          ok = OnEdge(h->GetAxis(a), fRanges[a].first) && OnEdge(h->GetAxis(a), fRanges[a].second);
+        }
+        if (ok) {
+          fLast = l;
+          return h;
+        }
+      }
+      std::cerr << "HistPyramid: requested widths are not multiples of the finest binning" << std::endl;
+      return nullptr;
+    }
+
+    void ApplyRanges(THnSparse* h) const {
+      for (size_t a = 0; a < fRanges.size(); a++) {
+        if (!(fRanges[a].first < fRanges[a].second)) continue;
+        TAxis* ax = h->GetAxis(a);
+        double w = (ax->GetXmax() - ax->GetXmin()) / ax->GetNbins();
+        // bins fully inside [lo, hi)
+        ax->SetRange(ax->FindFixBin(fRanges[a].first + 0.5 * w), ax->FindFixBin(fRanges[a].second - 0.5 * w));
+      }
+    }
+
+    void ClearRanges(THnSparse* h) const {
+      for (size_t a = 0; a < fRanges.size(); a++) h->GetAxis(a)->SetRange();
+    }
+
+    std::vector<THnSparse*> fLevels;  // coarsest first, finest (the base) last
+    std::vector<std::pair<double, double>> fRanges;
+    int fLast = -1;
+
+};
+
+#endif
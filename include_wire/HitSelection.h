@@ -0,0 +1,188 @@
+#ifndef HIT_SELECTION_H
+#define HIT_SELECTION_H
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+
+#include "CalibNTupleInfo.h"
+#include "StageTimer.h"
+
+
+/*
+
+  Hit quality selection as a separate stage
+
+  PlaneHits copies one plane's hit arrays of the current track into contiguous
+  buffers. HitMask then evaluates every hit-level cut of the fillers as a
+  lane-wise predicate in one pass and records the failed cuts of each hit as
+  bits. The accepted indices are compacted afterwards, so the calibration and
+  fill stages only iterate over the survivors.
+
+  The track angles only depend on (plane, tpc), so the caller passes them (and
+  the pathological width thresholds) per TPC instead of per hit.
+
+  Every filler with the hit loop uses it (HighDim, LowDim, NDMaps). The cuts
+  and the thirds tolerance differ between them, so each one sets its own
+  HitMaskConfig: the thirds tolerance is the default of the filler's
+  is_one_third / is_two_thirds (1e-4, 1e-3 or 1e-5), fillers without the
+  thirds, lifetime angle or pathological cuts turn them off.
+
+*/
+
+enum HitCutBit : uint16_t {
+  kCutNaN          = 1 << 0, // x is NaN
+  kCutOnTraj       = 1 << 1, // not on trajectory
+  kCutGoodness     = 1 << 2, // goodness >= 100
+  kCutMult         = 1 << 3, // multiplicity > 1
+  kCutHalfWidth    = 1 << 4, // hit trains: width in steps of exactly 0.5
+  kCutLifeAngle    = 1 << 5, // |theta_xz| > 49 deg (lifetime selection)
+  kCutThirds       = 1 << 6, // hit trains: fractional width of 1/3 or 2/3
+  kCutPathological = 1 << 7  // small width at large angle
+};
+
+const int kNHitCuts = 8;
+const char* const kHitCutNames[kNHitCuts] = {
+  "nan", "ontraj", "goodness", "mult", "half_width", "life_angle", "thirds", "pathological"
+};
+
+
+struct PlaneHits {
+
+  size_t n = 0;
+  std::vector<float> x, y, z;
+  std::vector<float> width, integral, goodness, dqdx;
+  std::vector<int> mult;
+  std::vector<unsigned short> tpc;
+  std::vector<unsigned char> ontraj;
+
+  void Resize(size_t size) {
+    n = size;
+    x.resize(n); y.resize(n); z.resize(n);
+    width.resize(n); integral.resize(n); goodness.resize(n); dqdx.resize(n);
+    mult.resize(n); tpc.resize(n); ontraj.resize(n);
+  }
+
+  void Load(MyCalib& my, unsigned ip) {
+    Resize(my.x[ip].GetSize());
+    for (size_t i = 0; i < n; i++) {
+      x[i] = my.x[ip][i];
+      y[i] = my.y[ip][i];
+      z[i] = my.z[ip][i];
+      width[i] = my.width[ip][i];
+      integral[i] = my.integral[ip][i];
+      goodness[i] = my.goodness[ip][i];
+      dqdx[i] = my.dqdx[ip][i];
+      mult[i] = my.mult[ip][i];
+      tpc[i] = my.tpc[ip][i];
+      ontraj[i] = my.ontraj[ip][i];
+    }
+  }
+
+};
+
+
+struct HitMaskConfig {
+  float thirds_tol;              // tolerance of the filler's is_one_third / is_two_thirds
+  bool thirds_cut = true;        // reject fractional widths of 1/3 or 2/3
+  bool mult_cut = true;          // only multi_dim_tracks_grid cuts on multiplicity
+  bool life_sel = false;         // reject |theta_xz| > 49
+  bool pathological_sel = false; // reject pathological hits (always flagged)
+
+  explicit HitMaskConfig(float tol) : thirds_tol(tol) {}
+};
+
+
+class HitMask {
+
+  public:
+
+    explicit HitMask(const HitMaskConfig& cfg) : fCfg(cfg) { Configure(cfg); }
+
+    void Configure(const HitMaskConfig& cfg) {
+      fCfg = cfg;
+      fReject = Rejects(cfg);
+    }
+
+    // cut bits that reject a hit under cfg
+    static uint16_t Rejects(const HitMaskConfig& cfg) {
+      uint16_t reject = kCutNaN | kCutOnTraj | kCutGoodness | kCutHalfWidth;
+      if (cfg.thirds_cut) reject |= kCutThirds;
+      if (cfg.mult_cut) reject |= kCutMult;
+      if (cfg.life_sel) reject |= kCutLifeAngle;
+      if (cfg.pathological_sel) reject |= kCutPathological;
+      return reject;
+    }
+
+    // thxz[tpc] = theta_xz of the track for this plane, path_thr[tpc] = txz_cut_threshold
+    void Build(const PlaneHits& hits, const float* thxz, const float* path_thr) {
+      WIREMOD_PROF_SCOPE(kStageHitMask);
+      size_t n = hits.n;
+      fFail.resize(n);
+
+      const float* x = hits.x.data();
+      const float* w = hits.width.data();
+      const float* g = hits.goodness.data();
+      const int* m = hits.mult.data();
+      const unsigned short* t = hits.tpc.data();
+      const unsigned char* on = hits.ontraj.data();
+
+      const bool life_angle[2] = { std::abs(thxz[0]) > 49, std::abs(thxz[1]) > 49 };
+      const float tol = fCfg.thirds_tol;
+
+      for (size_t i = 0; i < n; i++) {
+        int tpc = (t[i] != 0);
+        float w2 = w[i] * 2;
+        float frac = w[i] - std::floor(w[i]);
+        uint16_t f = 0;
+        f |= (x[i] != x[i]) ? kCutNaN : 0;
+        f |= (!on[i]) ? kCutOnTraj : 0;
+        f |= (g[i] >= 100.) ? kCutGoodness : 0;
+        f |= (m[i] > 1) ? kCutMult : 0;
+        f |= (std::abs(roundf(w2) - w2) < 0.00001f) ? kCutHalfWidth : 0;
+        f |= (life_angle[tpc]) ? kCutLifeAngle : 0;
+        f |= (std::fabs(frac - 1.0f/3.0f) < tol || std::fabs(frac - 2.0f/3.0f) < tol) ? kCutThirds : 0;
+        f |= (w[i] < path_thr[tpc]) ? kCutPathological : 0;
+        fFail[i] = f;
+      }
+
+      fAccepted.clear();
+      for (size_t i = 0; i < n; i++) {
+        if ((fFail[i] & fReject) == 0) fAccepted.push_back(i);
+      }
+    }
+
+    // Fillers without the angle cuts (life_sel and pathological_sel off)
+    void Build(const PlaneHits& hits) {
+      const float no_angle[2] = { 0.f, 0.f };
+      Build(hits, no_angle, no_angle);
+    }
+
+    const std::vector<unsigned>& Accepted() const { return fAccepted; }
+
+    // Positions in Accepted() of the hits that also pass a stricter reject
+    // mask (variant trains share one Build with the loosest configuration)
+    void Subset(uint16_t reject, std::vector<unsigned>& out) const {
+      out.clear();
+      for (size_t k = 0; k < fAccepted.size(); k++) {
+        if ((fFail[fAccepted[k]] & reject) == 0) out.push_back(k);
+      }
+    }
+    uint16_t Fail(size_t i) const { return fFail[i]; }
+    const std::vector<uint16_t>& Fails() const { return fFail; }
+    uint16_t RejectMask() const { return fReject; }
+
+    // Pathological flag is kept even when the hit is not rejected for it
+    bool Pathological(size_t i) const { return fFail[i] & kCutPathological; }
+
+  private:
+
+    HitMaskConfig fCfg;
+    uint16_t fReject = 0;
+    std::vector<uint16_t> fFail;
+    std::vector<unsigned> fAccepted;
+
+};
+
+#endif
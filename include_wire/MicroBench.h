@@ -0,0 +1,148 @@
+#ifndef MICRO_BENCH_H
+#define MICRO_BENCH_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <unistd.h>
+
+
+/*
+
+  Minimal microbenchmark harness
+
+  Run(name, items, fn) calls fn() in batches until a batch takes at least
+  min_time, then times `repeats` such batches and keeps the median and the
+  minimum. `items` is the number of elements one fn() call processes (hits,
+  bins, ...), so the per-item cost can be compared between implementations
+  that work on different batch sizes.
+
+  Results go to a JSON file (one object per benchmark plus commit/host/time
+  metadata) so runs on different commits can be diffed with a script.
+  Use Sink() on a value computed in fn() so the compiler cannot drop the work.
+
+*/
+
+struct BenchResult {
+  std::string name;
+  long iterations;     // fn() calls per timed batch
+  double items;        // items per fn() call
+  double ns_per_op;    // median over the repeats
+  double ns_per_op_min;
+  double ns_per_item;
+};
+
+
+class MicroBench {
+
+  public:
+
+    MicroBench(const std::string& suite, double min_time = 0.2, int repeats = 5)
+      : fSuite(suite), fMinTime(min_time), fRepeats(repeats) {}
+
+    template <typename T>
+    static inline void Sink(const T& v) {
+      static volatile double sink;
+      sink = (double)v;
+      (void)sink;
+    }
+
+    // Only run the benchmarks whose name contains `filter` (empty = all)
+    void SetFilter(const std::string& filter) { fFilter = filter; }
+    bool Selected(const std::string& name) const {
+      return fFilter.empty() || name.find(fFilter) != std::string::npos;
+    }
+
+    const BenchResult* Run(const std::string& name, double items, const std::function<void()>& fn) {
+      if (!Selected(name)) return nullptr;
+
+      // calibrate the batch size
+      long n = 1;
+      while (true) {
+        double t = Time(fn, n);
+        if (t >= fMinTime || n > (1L << 40)) break;
+        n = (t > 0) ? std::max(2 * n, (long)(n * fMinTime / t * 1.2)) : 2 * n;
+      }
+
+      std::vector<double> per_op;
+      for (int r = 0; r < fRepeats; r++) per_op.push_back(Time(fn, n) * 1e9 / n);
+      std::sort(per_op.begin(), per_op.end());
+
+      BenchResult res;
+      res.name = name;
+      res.iterations = n;
+      res.items = items;
+      res.ns_per_op = per_op[per_op.size() / 2];
+      res.ns_per_op_min = per_op.front();
+      res.ns_per_item = (items > 0) ? res.ns_per_op / items : res.ns_per_op;
+      fResults.push_back(res);
+
+      printf("  %-32s %14.1f ns/op %12.3f ns/item   (%ld x %d)\n", name.c_str(),
+             res.ns_per_op, res.ns_per_item, n, fRepeats);
+      return &fResults.back();
+    }
+
+    void Skip(const std::string& name, const std::string& reason) {
+      if (!Selected(name)) return;
+      printf("  %-32s skipped: %s\n", name.c_str(), reason.c_str());
+    }
+
+    const std::vector<BenchResult>& Results() const { return fResults; }
+
+    bool WriteJSON(const std::string& path, const std::string& commit = "") const {
+      std::ofstream out(path);
+      if (!out) {
+        std::cerr << "MicroBench: could not open " << path << std::endl;
+        return false;
+      }
+      char host[256] = "unknown";
+      gethostname(host, sizeof(host) - 1);
+      char when[64];
+      time_t now = time(nullptr);
+      strftime(when, sizeof(when), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+      out << "{\n";
+      out << "  \"suite\": \"" << fSuite << "\",\n";
+      out << "  \"commit\": \"" << commit << "\",\n";
+      out << "  \"host\": \"" << host << "\",\n";
+      out << "  \"time\": \"" << when << "\",\n";
+      out << "  \"results\": [\n";
+      for (size_t i = 0; i < fResults.size(); i++) {
+        const BenchResult& r = fResults[i];
+        char buf[512];
+        snprintf(buf, sizeof(buf),
+                 "    {\"name\": \"%s\", \"iterations\": %ld, \"items\": %g, \"ns_per_op\": %.3f, \"ns_per_op_min\": %.3f, \"ns_per_item\": %.4f}%s\n",
+                 r.name.c_str(), r.iterations, r.items, r.ns_per_op, r.ns_per_op_min, r.ns_per_item,
+                 (i + 1 < fResults.size()) ? "," : "");
+        out << buf;
+      }
+      out << "  ]\n}\n";
+      printf("MicroBench: wrote %zu results to %s\n", fResults.size(), path.c_str());
+      return true;
+    }
+
+  private:
+
+    static double Time(const std::function<void()>& fn, long n) {
+      auto t0 = std::chrono::steady_clock::now();
+      for (long i = 0; i < n; i++) fn();
+      auto t1 = std::chrono::steady_clock::now();
+      return std::chrono::duration<double>(t1 - t0).count();
+    }
+
+    std::string fSuite;
+    double fMinTime;
+    int fRepeats;
+    std::string fFilter;
+    std::vector<BenchResult> fResults;
+
+};
+
+#endif
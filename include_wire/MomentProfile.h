@@ -0,0 +1,298 @@
+#ifndef MOMENT_PROFILE_H
+#define MOMENT_PROFILE_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+
+#include "TTree.h"
+#include "TString.h"
+#include "TNamed.h"
+#include "TObjArray.h"
+#include "TObjString.h"
+#include "TH1D.h"
+#include "TH2D.h"
+
+#include "AxisSpec.h"
+
+
+/*
+
+  Streaming mean/RMS profiles (count, mean, M2 and optionally M3, M4 per bin)
+
+  For quick-look calibrations (width vs x, ...) only the mean, RMS and count
+  per bin are needed, not a 1600 bin width axis. Moments is updated per value
+  with Welford's recurrence (Terriberry's for M3/M4), which stays accurate
+  where sum(x^2) - n * mean^2 cancels, and two of them combine exactly with
+  the parallel formulas of Chan et al. / Pebay, so job outputs merge without
+  loss.
+
+  MomentProfile keeps one Moments per quantity for each bin (including
+  under/overflow) of the profiled axes (AxisSpec.h), in a flat array indexed
+  by AxisSet::Linear. The array is dense, so CheckSize() should be asked
+  before booking: x, y, z alone is 1.2 GB per profile. It is written as a TTree with one entry per filled
+  bin, which hadd concatenates; Read() combines entries of the same bin.
+  Hist() turns one statistic into a TH1D/TH2D (1 or 2 profiled axes).
+
+*/
+
+struct Moments {
+  double n = 0.;
+  double mean = 0.;
+  double m2 = 0.;
+  double m3 = 0.;
+  double m4 = 0.;
+
+  inline void Add(double x) {
+    double n1 = n;
+    n += 1.;
+    double delta = x - mean;
+    double delta_n = delta / n;
+    mean += delta_n;
+    m2 += delta * delta_n * n1;
+  }
+
+  inline void AddHigher(double x) {
+    double n1 = n;
+    n += 1.;
+    double delta = x - mean;
+    double delta_n = delta / n;
+    double delta_n2 = delta_n * delta_n;
+    double term1 = delta * delta_n * n1;
+    mean += delta_n;
+    m4 += term1 * delta_n2 * (n * n - 3 * n + 3) + 6 * delta_n2 * m2 - 4 * delta_n * m3;
+    m3 += term1 * delta_n * (n - 2) - 3 * delta_n * m2;
+    m2 += term1;
+  }
+
+  void Combine(const Moments& o) {
+    if (o.n == 0) return;
+    if (n == 0) {
+      *this = o;
+      return;
+    }
+    double na = n, nb = o.n, nn = na + nb;
+    double delta = o.mean - mean;
+    double d2 = delta * delta, d3 = d2 * delta, d4 = d2 * d2;
+    double c4 = m4 + o.m4 + d4 * na * nb * (na * na - na * nb + nb * nb) / (nn * nn * nn)
+              + 6. * d2 * (na * na * o.m2 + nb * nb * m2) / (nn * nn)
+              + 4. * delta * (na * o.m3 - nb * m3) / nn;
+    double c3 = m3 + o.m3 + d3 * na * nb * (na - nb) / (nn * nn)
+              + 3. * delta * (na * o.m2 - nb * m2) / nn;
+    m2 += o.m2 + d2 * na * nb / nn;
+    m3 = c3;
+    m4 = c4;
+    mean += delta * nb / nn;
+    n = nn;
+  }
+
+  double Variance() const { return (n > 1) ? m2 / (n - 1) : 0.; }
+  double Rms() const { return (n > 0) ? std::sqrt(m2 / n) : 0.; }
+  double MeanError() const { return (n > 1) ? std::sqrt(Variance() / n) : 0.; }
+  double Skewness() const { return (m2 > 0) ? std::sqrt(n) * m3 / std::pow(m2, 1.5) : 0.; }
+  double Kurtosis() const { return (m2 > 0) ? n * m4 / (m2 * m2) - 3. : 0.; }
+};
+
+
+class MomentProfile {
+
+  public:
+
+    enum Stat { kCount, kMean, kRms, kSkewness, kKurtosis };
+
+    MomentProfile(const AxisSet& axes, const std::vector<std::string>& quantities, bool higher = false)
+      : fAxes(axes), fQuantities(quantities), fHigher(higher) {
+      fCells = 1;
+      for (size_t d = 0; d < fAxes.NDim(); d++) fCells *= fAxes.Axis(d).nbins + 2;
+      fMoments.resize(fCells * fQuantities.size());
+      fCoord.resize(fAxes.NDim());
+    }
+
+    // Whether nprofiles dense arrays over axes fit in WIREMOD_MOMENTS_MB
+    // (default 2048); prints the size and returns false if not
+    static bool CheckSize(const AxisSet& axes, size_t nquantities, size_t nprofiles) {
+      double mb = axes.LinearSize() * nquantities * sizeof(Moments) * nprofiles / 1048576.;
+      double max_mb = getenv("WIREMOD_MOMENTS_MB") ? atof(getenv("WIREMOD_MOMENTS_MB")) : 2048.;
+      if (mb <= max_mb) return true;
+      std::cerr << "MomentProfile: " << nprofiles << " profiles over these axes need " << (long long)mb
+                << " MB, more than WIREMOD_MOMENTS_MB=" << max_mb << " --> use fewer or coarser axes" << std::endl;
+      return false;
+    }
+
+    size_t NQuantities() const { return fQuantities.size(); }
+    const std::string& Quantity(size_t q) const { return fQuantities[q]; }
+    const AxisSet& Axes() const { return fAxes; }
+    bool Higher() const { return fHigher; }
+
+    // x: values of the profiled axes, q: one value per quantity
+    inline void Fill(const double* x, const double* q) {
+      fAxes.Bin(x, fCoord.data());
+      Moments* m = &fMoments[fAxes.Linear(fCoord.data()) * fQuantities.size()];
+      for (size_t i = 0; i < fQuantities.size(); i++) {
+        if (!std::isfinite(q[i])) continue;
+        if (fHigher) m[i].AddHigher(q[i]);
+        else m[i].Add(q[i]);
+      }
+    }
+
+    const Moments& Get(Long64_t bin, size_t quantity) const { return fMoments[bin * fQuantities.size() + quantity]; }
+
+    void Combine(const MomentProfile& o) {
+      for (size_t k = 0; k < fMoments.size() && k < o.fMoments.size(); k++) fMoments[k].Combine(o.fMoments[k]);
+    }
+
+    // One entry per filled bin in a tree called name
+    void Write(const char* name) const {
+      TTree* tree = new TTree(name, "Moments per profile bin (MomentProfile.h)");
+      Long64_t bin;
+      size_t nq = fQuantities.size();
+      std::vector<Double_t> cols(5 * nq);
+      tree->Branch("bin", &bin, "bin/L");
+      for (size_t q = 0; q < nq; q++) {
+        const char* qn = fQuantities[q].c_str();
+        tree->Branch(Form("%s_n", qn), &cols[5 * q + 0], Form("%s_n/D", qn));
+        tree->Branch(Form("%s_mean", qn), &cols[5 * q + 1], Form("%s_mean/D", qn));
+        tree->Branch(Form("%s_m2", qn), &cols[5 * q + 2], Form("%s_m2/D", qn));
+        tree->Branch(Form("%s_m3", qn), &cols[5 * q + 3], Form("%s_m3/D", qn));
+        tree->Branch(Form("%s_m4", qn), &cols[5 * q + 4], Form("%s_m4/D", qn));
+      }
+      Long64_t nfilled = 0;
+      for (Long64_t b = 0; b < fCells; b++) {
+        bool filled = false;
+        for (size_t q = 0; q < nq; q++) {
+          const Moments& m = Get(b, q);
+          filled |= (m.n > 0);
+          cols[5 * q + 0] = m.n;
+          cols[5 * q + 1] = m.mean;
+          cols[5 * q + 2] = m.m2;
+          cols[5 * q + 3] = m.m3;
+          cols[5 * q + 4] = m.m4;
+        }
+        if (!filled) continue;
+        bin = b;
+        tree->Fill();
+        nfilled++;
+      }
+      TString axes, quantities;
+      for (size_t d = 0; d < fAxes.NDim(); d++) {
+        const AxisSpec& a = fAxes.Axis(d);
+        axes += Form("%s%s %d %.17g %.17g", d ? ";" : "", a.name.c_str(), a.nbins, a.xmin, a.xmax);
+      }
+      for (size_t q = 0; q < nq; q++) quantities += Form("%s%s", q ? ";" : "", fQuantities[q].c_str());
+      tree->GetUserInfo()->Add(new TNamed("axes", axes.Data()));
+      tree->GetUserInfo()->Add(new TNamed("quantities", quantities.Data()));
+      tree->GetUserInfo()->Add(new TNamed("higher", fHigher ? "1" : "0"));
+      tree->Write();
+      printf("MomentProfile: wrote %lld of %lld bins x %zu quantities to %s\n", nfilled, fCells, nq, name);
+      delete tree;
+    }
+
+    // Combine all entries of a (possibly hadd-ed) moment tree
+    bool Read(TTree* tree) {
+      if (!tree) return false;
+      Long64_t bin;
+      size_t nq = fQuantities.size();
+      std::vector<Double_t> cols(5 * nq);
+      tree->SetBranchAddress("bin", &bin);
+      for (size_t q = 0; q < nq; q++) {
+        const char* qn = fQuantities[q].c_str();
+        tree->SetBranchAddress(Form("%s_n", qn), &cols[5 * q + 0]);
+        tree->SetBranchAddress(Form("%s_mean", qn), &cols[5 * q + 1]);
+        tree->SetBranchAddress(Form("%s_m2", qn), &cols[5 * q + 2]);
+        tree->SetBranchAddress(Form("%s_m3", qn), &cols[5 * q + 3]);
+        tree->SetBranchAddress(Form("%s_m4", qn), &cols[5 * q + 4]);
+      }
+      for (Long64_t e = 0; e < tree->GetEntries(); e++) {
+        tree->GetEntry(e);
+        if (bin < 0 || bin >= fCells) continue;
+        for (size_t q = 0; q < nq; q++) {
+          Moments m;
+          m.n = cols[5 * q + 0];
+          m.mean = cols[5 * q + 1];
+          m.m2 = cols[5 * q + 2];
+          m.m3 = cols[5 * q + 3];
+          m.m4 = cols[5 * q + 4];
+          fMoments[bin * nq + q].Combine(m);
+        }
+      }
+      tree->ResetBranchAddresses();
+      return true;
+    }
+
+    // Profile written by Write(), read back with its axes and quantities
+    static MomentProfile* Load(TTree* tree) {
+      TNamed* a = tree ? (TNamed*)tree->GetUserInfo()->FindObject("axes") : nullptr;
+      TNamed* q = tree ? (TNamed*)tree->GetUserInfo()->FindObject("quantities") : nullptr;
+      TNamed* hi = tree ? (TNamed*)tree->GetUserInfo()->FindObject("higher") : nullptr;
+      if (!a || !q) return nullptr;
+      std::vector<AxisSpec> specs;
+      TObjArray* toks = TString(a->GetTitle()).Tokenize(";");
+      for (int i = 0; i < toks->GetEntries(); i++) {
+        char name[64];
+        int nb;
+        double lo, up;
+        if (sscanf(((TObjString*)toks->At(i))->GetString().Data(), "%63s %d %lf %lf", name, &nb, &lo, &up) == 4) specs.push_back(AxisSpec(name, nb, lo, up));
+      }
+      delete toks;
+      std::vector<std::string> quantities;
+      toks = TString(q->GetTitle()).Tokenize(";");
+      for (int i = 0; i < toks->GetEntries(); i++) quantities.push_back(((TObjString*)toks->At(i))->GetString().Data());
+      delete toks;
+      MomentProfile* p = new MomentProfile(AxisSet(specs), quantities, hi && TString(hi->GetTitle()) == "1");
+      p->Read(tree);
+      return p;
+    }
+
+    // One statistic of one quantity over the profiled axes (1 or 2 of them);
+    // kMean bins carry the error on the mean
+    TH1* Hist(size_t quantity, Stat stat, const char* name) const {
+      if (fAxes.NDim() == 0 || fAxes.NDim() > 2) {
+        std::cerr << "MomentProfile: Hist needs 1 or 2 profiled axes" << std::endl;
+        return nullptr;
+      }
+      const AxisSpec& ax = fAxes.Axis(0);
+      TH1* h;
+      if (fAxes.NDim() == 1) h = new TH1D(name, "", ax.nbins, ax.xmin, ax.xmax);
+      else {
+        const AxisSpec& ay = fAxes.Axis(1);
+        h = new TH2D(name, "", ax.nbins, ax.xmin, ax.xmax, ay.nbins, ay.xmin, ay.xmax);
+      }
+      h->SetDirectory(0);
+      h->GetXaxis()->SetTitle(ax.title.c_str());
+      if (fAxes.NDim() == 2) h->GetYaxis()->SetTitle(fAxes.Axis(1).title.c_str());
+      Int_t coord[2] = { 0, 0 };
+      int ny = (fAxes.NDim() == 2) ? fAxes.Axis(1).nbins + 1 : 0;
+      for (coord[0] = 0; coord[0] <= ax.nbins + 1; coord[0]++) {
+        for (coord[1] = 0; coord[1] <= ny; coord[1]++) {
+          const Moments& m = Get(fAxes.Linear(coord), quantity);
+          if (m.n == 0) continue;
+          Int_t bin = (fAxes.NDim() == 1) ? coord[0] : h->GetBin(coord[0], coord[1]);
+          double v = 0.;
+          switch (stat) {
+            case kCount: v = m.n; break;
+            case kMean: v = m.mean; break;
+            case kRms: v = m.Rms(); break;
+            case kSkewness: v = m.Skewness(); break;
+            case kKurtosis: v = m.Kurtosis(); break;
+          }
+          h->SetBinContent(bin, v);
+          h->SetBinError(bin, (stat == kMean) ? m.MeanError() : 0.);
+        }
+      }
+      return h;
+    }
+
+  private:
+
+    AxisSet fAxes;
+    std::vector<std::string> fQuantities;
+    bool fHigher;
+    Long64_t fCells;
+    std::vector<Moments> fMoments;
+    std::vector<Int_t> fCoord;
+
+};
+
+#endif
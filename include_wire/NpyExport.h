@@ -0,0 +1,224 @@
+#ifndef NPY_EXPORT_H
+#define NPY_EXPORT_H
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "TH1.h"
+#include "TH2.h"
+#include "TAxis.h"
+#include "TString.h"
+#include "THnBase.h"
+#include "THnSparse.h"
+
+
+/*
+
+  Export of histograms as .npy arrays for the notebooks
+
+  Each array is a plain NumPy .npy file (format 1.0, little endian, C order)
+  with the header padded to 64 bytes, so the data are aligned and
+  np.load(path, mmap_mode="r") maps them without a copy.
+
+  Dense histograms and projections, <dir>/<name>.*.npy:
+    edges<d>    float64[n_d + 1]           bin edges of axis d (no under/overflow)
+    contents    float64[n_0, ..., n_k-1]   bin contents
+    errors      float64[n_0, ..., n_k-1]   bin errors (sqrt(sumw2) or sqrt(content))
+
+  Sparse (coordinate list) for THnSparse of any dimension:
+    coords      int32[nfilled, ndim]       bin index per axis, 1..n (0 / n+1 = under/overflow)
+    contents    float64[nfilled]
+    errors      float64[nfilled]           only if the histogram has sumw2
+    edges<d>    float64[n_d + 1]
+
+  Every export also writes <dir>/<name>.json describing the arrays (axis
+  titles, shapes, dims of the original histogram). PyAna/npy_hist.py loads
+  them back.
+
+*/
+
+template <typename T> struct NpyType;
+template <> struct NpyType<double>   { static const char* Descr() { return "<f8"; } };
+template <> struct NpyType<float>    { static const char* Descr() { return "<f4"; } };
+template <> struct NpyType<int32_t>  { static const char* Descr() { return "<i4"; } };
+template <> struct NpyType<int64_t>  { static const char* Descr() { return "<i8"; } };
+template <> struct NpyType<uint16_t> { static const char* Descr() { return "<u2"; } };
+
+template <typename T>
+bool npy_write(const std::string& path, const T* data, const std::vector<size_t>& shape) {
+  std::ostringstream dict;
+  dict << "{'descr': '" << NpyType<T>::Descr() << "', 'fortran_order': False, 'shape': (";
+  size_t n = 1;
+  for (size_t i = 0; i < shape.size(); i++) {
+    dict << shape[i] << ((shape.size() == 1 || i + 1 < shape.size()) ? ", " : "");
+    n *= shape[i];
+  }
+  dict << "), }";
+  std::string header = dict.str();
+  // magic (6) + version (2) + header length (2) + header + '\n', padded to 64
+  size_t total = 10 + header.size() + 1;
+  header.append((64 - total % 64) % 64, ' ');
+  header += '\n';
+
+  std::ofstream out(path, std::ios::binary);
+  if (!out) {
+    std::cerr << "npy_write: could not create " << path << std::endl;
+    return false;
+  }
+  const char magic[8] = { '\x93', 'N', 'U', 'M', 'P', 'Y', 1, 0 };
+  uint16_t hlen = header.size();
+  out.write(magic, 8);
+  out.write((const char*)&hlen, 2);
+  out.write(header.data(), header.size());
+  out.write((const char*)data, n * sizeof(T));
+  return (bool)out;
+}
+
+template <typename T>
+bool npy_write(const std::string& path, const std::vector<T>& data, const std::vector<size_t>& shape) {
+  return npy_write(path, data.data(), shape);
+}
+
+inline std::vector<double> axis_edges(const TAxis* ax) {
+  std::vector<double> e(ax->GetNbins() + 1);
+  for (int b = 1; b <= ax->GetNbins(); b++) e[b - 1] = ax->GetBinLowEdge(b);
+  e.back() = ax->GetBinUpEdge(ax->GetNbins());
+  return e;
+}
+
+inline std::string json_escape(const std::string& s) {
+  std::string o;
+  for (char c : s) {
+    if (c == '"' || c == '\\') o += '\\';
+    o += c;
+  }
+  return o;
+}
+
+
+class NpyExporter {
+
+  public:
+
+    NpyExporter(const std::string& dir) : fDir(dir) {}
+
+    // TH1/TH2/TH3 (no under/overflow)
+    bool Dense(const TH1* h, const std::string& name) {
+      int ndim = h->GetDimension();
+      const TAxis* axes[3] = { h->GetXaxis(), h->GetYaxis(), h->GetZaxis() };
+      std::vector<size_t> shape;
+      for (int d = 0; d < ndim; d++) shape.push_back(axes[d]->GetNbins());
+      size_t n = 1;
+      for (size_t s : shape) n *= s;
+      std::vector<double> c(n), e(n);
+      // C order: the last axis runs fastest
+      size_t k = 0;
+      int nx = axes[0]->GetNbins();
+      int ny = (ndim > 1) ? axes[1]->GetNbins() : 1;
+      int nz = (ndim > 2) ? axes[2]->GetNbins() : 1;
+      for (int ix = 1; ix <= nx; ix++)
+        for (int iy = 1; iy <= ny; iy++)
+          for (int iz = 1; iz <= nz; iz++, k++) {
+            int bin = h->GetBin(ix, ndim > 1 ? iy : 0, ndim > 2 ? iz : 0);
+            c[k] = h->GetBinContent(bin);
+            e[k] = h->GetBinError(bin);
+          }
+      bool ok = npy_write(Path(name, "contents"), c, shape) && npy_write(Path(name, "errors"), e, shape);
+      std::vector<const TAxis*> ax(axes, axes + ndim);
+      for (int d = 0; d < ndim; d++) ok &= npy_write(Path(name, Form("edges%d", d)), axis_edges(axes[d]), { shape[d] + 1 });
+      ok &= Manifest(name, "dense", h->GetName(), ax, shape, 0);
+      return ok;
+    }
+
+    // THnBase (sparse or not) as a dense array; only for small projections
+    bool Dense(const THnBase* h, const std::string& name) {
+      int ndim = h->GetNdimensions();
+      std::vector<size_t> shape;
+      std::vector<const TAxis*> ax;
+      size_t n = 1;
+      for (int d = 0; d < ndim; d++) {
+        ax.push_back(h->GetAxis(d));
+        shape.push_back(h->GetAxis(d)->GetNbins());
+        n *= shape.back();
+      }
+      std::vector<double> c(n, 0.), e(n, 0.);
+      std::vector<Int_t> idx(ndim);
+      THnIter iter(h, false);
+      Long64_t bin;
+      while ((bin = iter.Next(idx.data())) >= 0) {
+        size_t k = 0;
+        bool flow = false;
+        for (int d = 0; d < ndim; d++) {
+          if (idx[d] < 1 || idx[d] > (int)shape[d]) { flow = true; break; }
+          k = k * shape[d] + (idx[d] - 1);
+        }
+        if (flow) continue;
+        c[k] = h->GetBinContent(bin);
+        e[k] = h->GetBinError(bin);
+      }
+      bool ok = npy_write(Path(name, "contents"), c, shape) && npy_write(Path(name, "errors"), e, shape);
+      for (int d = 0; d < ndim; d++) ok &= npy_write(Path(name, Form("edges%d", d)), axis_edges(ax[d]), { shape[d] + 1 });
+      ok &= Manifest(name, "dense", h->GetName(), ax, shape, 0);
+      return ok;
+    }
+
+    // THnSparse as a coordinate list of its filled bins
+    bool Coo(const THnSparse* h, const std::string& name) {
+      int ndim = h->GetNdimensions();
+      Long64_t nfilled = h->GetNbins();
+      std::vector<int32_t> coords((size_t)nfilled * ndim);
+      std::vector<double> c(nfilled), e;
+      bool sumw2 = h->GetCalculateErrors();
+      if (sumw2) e.resize(nfilled);
+      std::vector<Int_t> idx(ndim);
+      for (Long64_t i = 0; i < nfilled; i++) {
+        c[i] = h->GetBinContent(i, idx.data());
+        for (int d = 0; d < ndim; d++) coords[(size_t)i * ndim + d] = idx[d];
+        if (sumw2) e[i] = h->GetBinError(i);
+      }
+      std::vector<size_t> shape;
+      std::vector<const TAxis*> ax;
+      for (int d = 0; d < ndim; d++) {
+        ax.push_back(h->GetAxis(d));
+        shape.push_back(h->GetAxis(d)->GetNbins());
+      }
+      bool ok = npy_write(Path(name, "coords"), coords, { (size_t)nfilled, (size_t)ndim })
+             && npy_write(Path(name, "contents"), c, { (size_t)nfilled });
+      if (sumw2) ok &= npy_write(Path(name, "errors"), e, { (size_t)nfilled });
+      for (int d = 0; d < ndim; d++) ok &= npy_write(Path(name, Form("edges%d", d)), axis_edges(ax[d]), { shape[d] + 1 });
+      ok &= Manifest(name, "coo", h->GetName(), ax, shape, nfilled);
+      return ok;
+    }
+
+  private:
+
+    std::string Path(const std::string& name, const std::string& array) const {
+      return fDir + "/" + name + "." + array + ".npy";
+    }
+
+    bool Manifest(const std::string& name, const char* layout, const char* source,
+                  const std::vector<const TAxis*>& ax, const std::vector<size_t>& shape, Long64_t nfilled) const {
+      std::ofstream out(fDir + "/" + name + ".json");
+      out << "{\n  \"name\": \"" << json_escape(name) << "\",\n"
+          << "  \"source\": \"" << json_escape(source) << "\",\n"
+          << "  \"layout\": \"" << layout << "\",\n"
+          << "  \"nfilled\": " << nfilled << ",\n"
+          << "  \"axes\": [\n";
+      for (size_t d = 0; d < ax.size(); d++) {
+        out << "    {\"title\": \"" << json_escape(ax[d]->GetTitle()) << "\", \"nbins\": " << shape[d]
+            << ", \"min\": " << ax[d]->GetXmin() << ", \"max\": " << ax[d]->GetXmax() << "}"
+            << (d + 1 < ax.size() ? "," : "") << "\n";
+      }
+      out << "  ]\n}\n";
+      return (bool)out;
+    }
+
+    std::string fDir;
+
+};
+
+#endif
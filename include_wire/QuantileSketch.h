@@ -0,0 +1,399 @@
+#ifndef QUANTILE_SKETCH_H
+#define QUANTILE_SKETCH_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "TTree.h"
+#include "TString.h"
+#include "TNamed.h"
+#include "TObjArray.h"
+#include "TObjString.h"
+
+#include "AxisSpec.h"
+
+
+/*
+
+  Mergeable quantile sketches of the hit charge/width per profile bin
+
+  The fillers keep full 1000 bin Q and 1600 bin W axes in the THnSparse only
+  to get the ITM, median and quantile cuts per profile bin later. A
+  QuantileSketch is a merging t-digest: at most ~2 * compression centroids
+  (mean, weight) plus an insert buffer, small centroids at the tails and
+  large ones in the middle, so the quantile error is relative to q(1 - q).
+  Two sketches merge by merging their centroids, in any order.
+
+  Between neighbouring centroids the distribution is taken as uniform (half
+  of each centroid's weight on either side, the min/max closing the tails).
+  That gives Cdf/Quantile and the mean and variance inside a window, which
+  is all TruncatedMean needs to redo iterative_truncated_mean (median +
+  [sig_down, sig_up] * rms of the current window, until the mean moves less
+  than tol) without the histogram.
+
+  SketchProfile holds one sketch per filled bin of the profiled axes
+  (AxisSpec.h) for each quantity. It is written as a TTree, one entry per
+  (bin, quantity) sketch, so hadd of job outputs just concatenates entries
+  and Read() merges the ones with the same key.
+
+*/
+
+class QuantileSketch {
+
+  public:
+
+    struct Centroid {
+      double mean;
+      double weight;
+    };
+
+    explicit QuantileSketch(double compression = 200.) : fCompression(compression) {}
+
+    void Add(double x, double w = 1.) {
+      if (!std::isfinite(x) || w <= 0) return;
+      fBuffer.push_back({ x, w });
+      fMin = std::min(fMin, x);
+      fMax = std::max(fMax, x);
+      if (fBuffer.size() >= BufferSize()) Compress();
+    }
+
+    void Merge(const QuantileSketch& other) {
+      if (other.Empty()) return;
+      fBuffer.insert(fBuffer.end(), other.fCentroids.begin(), other.fCentroids.end());
+      fBuffer.insert(fBuffer.end(), other.fBuffer.begin(), other.fBuffer.end());
+      fMin = std::min(fMin, other.fMin);
+      fMax = std::max(fMax, other.fMax);
+      Compress();
+    }
+
+    // Fold the buffer into the centroids (scale function k1)
+    void Compress() {
+      if (fBuffer.empty()) return;
+      fBuffer.insert(fBuffer.end(), fCentroids.begin(), fCentroids.end());
+      std::sort(fBuffer.begin(), fBuffer.end(), [](const Centroid& a, const Centroid& b) { return a.mean < b.mean; });
+      double total = 0.;
+      for (const Centroid& c : fBuffer) total += c.weight;
+      fCentroids.clear();
+      Centroid cur = fBuffer[0];
+      double done = 0.;
+      double k_lo = K(0.);
+      for (size_t i = 1; i < fBuffer.size(); i++) {
+        const Centroid& c = fBuffer[i];
+        double q = (done + cur.weight + c.weight) / total;
+        if (K(q) - k_lo <= 1.) {
+          cur.mean += (c.mean - cur.mean) * c.weight / (cur.weight + c.weight);
+          cur.weight += c.weight;
+        }
+        else {
+          done += cur.weight;
+          fCentroids.push_back(cur);
+          k_lo = K(done / total);
+          cur = c;
+        }
+      }
+      fCentroids.push_back(cur);
+      fTotal = total;
+      fBuffer.clear();
+    }
+
+    bool Empty() const { return fCentroids.empty() && fBuffer.empty(); }
+    double Total() { Compress(); return fTotal; }
+    double Min() const { return fMin; }
+    double Max() const { return fMax; }
+    size_t NCentroids() { Compress(); return fCentroids.size(); }
+    const std::vector<Centroid>& Centroids() { Compress(); return fCentroids; }
+
+    // Weight below x
+    double Cdf(double x) {
+      Compress();
+      if (fCentroids.empty() || x <= fMin) return 0.;
+      if (x >= fMax) return fTotal;
+      double c = 0.;
+      double lo = fMin;
+      for (size_t i = 0; i <= fCentroids.size(); i++) {
+        double hi = (i < fCentroids.size()) ? fCentroids[i].mean : fMax;
+        double m = Segment(i);
+        if (x < hi) return c + ((hi > lo) ? m * (x - lo) / (hi - lo) : m);
+        c += m;
+        lo = hi;
+      }
+      return fTotal;
+    }
+
+    // x below which a fraction q of the weight lies
+    double Quantile(double q) {
+      Compress();
+      if (fCentroids.empty()) return 0.;
+      double target = std::min(std::max(q, 0.), 1.) * fTotal;
+      double c = 0.;
+      double lo = fMin;
+      for (size_t i = 0; i <= fCentroids.size(); i++) {
+        double hi = (i < fCentroids.size()) ? fCentroids[i].mean : fMax;
+        double m = Segment(i);
+        if (c + m >= target) return (m > 0) ? lo + (hi - lo) * (target - c) / m : lo;
+        c += m;
+        lo = hi;
+      }
+      return fMax;
+    }
+
+    // Weight, mean and variance inside [a, b]
+    void Moments(double a, double b, double& w, double& mean, double& var) {
+      Compress();
+      double s0 = 0., s1 = 0., s2 = 0.;
+      double lo = fMin;
+      for (size_t i = 0; i <= fCentroids.size(); i++) {
+        double hi = (i < fCentroids.size()) ? fCentroids[i].mean : fMax;
+        double m = Segment(i);
+        double p = std::max(lo, a), r = std::min(hi, b);
+        if (hi <= lo) {
+          // point mass (single valued segment)
+          if (lo >= a && lo <= b) { s0 += m; s1 += m * lo; s2 += m * lo * lo; }
+        }
+        else if (r > p) {
+          double f = m * (r - p) / (hi - lo);
+          s0 += f;
+          s1 += f * 0.5 * (p + r);
+          s2 += f * (p * p + p * r + r * r) / 3.;
+        }
+        lo = hi;
+      }
+      w = s0;
+      mean = (s0 > 0) ? s1 / s0 : 0.;
+      var = (s0 > 0) ? std::max(s2 / s0 - mean * mean, 0.) : 0.;
+    }
+
+    // Approximate iterative_truncated_mean (itm_fit.h): result = { mean, sd / sqrt(n) }
+    // of the converged window; returns the number of iterations. With
+    // bin_width > 0 the window is widened to the edges of that binning
+    // (starting at edge0), like the histogram version keeps every bin that
+    // overlaps it. The windows are nested: each one is cut from the
+    // previous, so an asymmetric cut cannot move back out to entries an
+    // earlier pass dropped
+    int TruncatedMean(double sig_down, double sig_up, double tol, double* result,
+                      double bin_width = 0., double edge0 = 0., int max_iter = 100) {
+      if (sig_down > sig_up) std::swap(sig_down, sig_up);
+      Compress();
+      result[0] = result[1] = 0.;
+      if (fCentroids.empty()) return 0;
+      double a = fMin, b = fMax;
+      double w, mean, var;
+      Moments(a, b, w, mean, var);
+      double prev = mean + 2 * tol + 1.;
+      int iter = 0;
+      while (std::fabs(prev - mean) >= tol && iter < max_iter && w > 0) {
+        prev = mean;
+        double sd = std::sqrt(var);
+        double ca = Cdf(a), cb = Cdf(b);
+        double median = Quantile(0.5 * (ca + cb) / fTotal);
+        double na = median + sig_down * sd;
+        double nb = median + sig_up * sd;
+        if (bin_width > 0) {
+          na = edge0 + bin_width * std::floor((na - edge0) / bin_width);
+          nb = edge0 + bin_width * std::ceil((nb - edge0) / bin_width);
+        }
+        // each pass cuts the previous window, as the histogram version
+        // recurses on the already truncated histogram
+        a = std::max(a, na);
+        b = std::min(b, nb);
+        Moments(a, b, w, mean, var);
+        iter++;
+      }
+      result[0] = mean;
+      result[1] = (w > 0) ? std::sqrt(var / w) : 0.;
+      return iter;
+    }
+
+  private:
+
+    friend class SketchProfile;
+
+    size_t BufferSize() const { return (size_t)(5 * fCompression) + 16; }
+
+    // k1 scale: centroids hold at most one unit of k each
+    double K(double q) const {
+      q = std::min(std::max(q, 0.), 1.);
+      return fCompression / (2. * M_PI) * std::asin(2. * q - 1.);
+    }
+
+    // Weight between centroid i - 1 and i (i = 0: from the min, i = n: to the max)
+    double Segment(size_t i) const {
+      double m = 0.;
+      if (i > 0) m += 0.5 * fCentroids[i - 1].weight;
+      if (i < fCentroids.size()) m += 0.5 * fCentroids[i].weight;
+      return m;
+    }
+
+    double fCompression;
+    double fTotal = 0.;
+    double fMin = HUGE_VAL;
+    double fMax = -HUGE_VAL;
+    std::vector<Centroid> fCentroids;
+    std::vector<Centroid> fBuffer;
+
+};
+
+
+// Sketches of nq quantities per filled bin of the profiled axes
+class SketchProfile {
+
+  public:
+
+    SketchProfile(const AxisSet& axes, const std::vector<std::string>& quantities, double compression = 200.)
+      : fAxes(axes), fQuantities(quantities), fCompression(compression) {}
+
+    size_t NQuantities() const { return fQuantities.size(); }
+    const AxisSet& Axes() const { return fAxes; }
+
+    // x: values of the profiled axes, q: one value per quantity
+    void Fill(const double* x, const double* q) {
+      std::vector<Int_t>& coord = fCoord;
+      coord.resize(fAxes.NDim());
+      fAxes.Bin(x, coord.data());
+      FillBin(fAxes.Linear(coord.data()), q);
+    }
+
+    void FillBin(Long64_t bin, const double* q) {
+      std::vector<QuantileSketch>& s = Slot(bin);
+      for (size_t i = 0; i < fQuantities.size(); i++) s[i].Add(q[i]);
+    }
+
+    // nullptr if the bin was never filled
+    QuantileSketch* Get(Long64_t bin, size_t quantity) {
+      auto it = fBins.find(bin);
+      return (it == fBins.end()) ? nullptr : &it->second[quantity];
+    }
+
+    std::vector<Long64_t> Bins() const {
+      std::vector<Long64_t> b;
+      for (const auto& kv : fBins) b.push_back(kv.first);
+      std::sort(b.begin(), b.end());
+      return b;
+    }
+
+    size_t Centroids() {
+      size_t n = 0;
+      for (auto& kv : fBins) for (auto& s : kv.second) n += s.NCentroids();
+      return n;
+    }
+
+    // One entry per (bin, quantity) sketch in a tree called name
+    void Write(const char* name) {
+      TTree* tree = new TTree(name, "Quantile sketches per profile bin (QuantileSketch.h)");
+      Long64_t bin;
+      Int_t quantity, n;
+      Double_t compression = fCompression, vmin, vmax;
+      size_t nmax = 1;
+      for (auto& kv : fBins) for (auto& s : kv.second) nmax = std::max(nmax, s.NCentroids());
+      std::vector<Double_t> means(nmax), weights(nmax);
+      tree->Branch("bin", &bin, "bin/L");
+      tree->Branch("quantity", &quantity, "quantity/I");
+      tree->Branch("compression", &compression, "compression/D");
+      tree->Branch("min", &vmin, "min/D");
+      tree->Branch("max", &vmax, "max/D");
+      tree->Branch("n", &n, "n/I");
+      tree->Branch("mean", means.data(), "mean[n]/D");
+      tree->Branch("weight", weights.data(), "weight[n]/D");
+      for (Long64_t b : Bins()) {
+        for (size_t i = 0; i < fQuantities.size(); i++) {
+          QuantileSketch& s = fBins[b][i];
+          const std::vector<QuantileSketch::Centroid>& cs = s.Centroids();
+          bin = b;
+          quantity = i;
+          n = cs.size();
+          vmin = s.Min();
+          vmax = s.Max();
+          for (size_t k = 0; k < cs.size(); k++) {
+            means[k] = cs[k].mean;
+            weights[k] = cs[k].weight;
+          }
+          tree->Fill();
+        }
+      }
+      // axes and quantity names, so a reader needs nothing else
+      TString axes, quantities;
+      for (size_t d = 0; d < fAxes.NDim(); d++) {
+        const AxisSpec& a = fAxes.Axis(d);
+        axes += Form("%s%s %d %.17g %.17g", d ? ";" : "", a.name.c_str(), a.nbins, a.xmin, a.xmax);
+      }
+      for (size_t i = 0; i < fQuantities.size(); i++) quantities += Form("%s%s", i ? ";" : "", fQuantities[i].c_str());
+      tree->GetUserInfo()->Add(new TNamed("axes", axes.Data()));
+      tree->GetUserInfo()->Add(new TNamed("quantities", quantities.Data()));
+      tree->Write();
+      printf("SketchProfile: wrote %zu bins x %zu quantities to %s\n", fBins.size(), fQuantities.size(), name);
+      delete tree;
+    }
+
+    // Merge all entries of a (possibly hadd-ed) sketch tree
+    bool Read(TTree* tree) {
+      if (!tree) return false;
+      Long64_t bin;
+      Int_t quantity, n;
+      Double_t vmin, vmax;
+      Int_t nmax = (Int_t)tree->GetMaximum("n");
+      std::vector<Double_t> means(nmax + 1), weights(nmax + 1);
+      tree->SetBranchAddress("bin", &bin);
+      tree->SetBranchAddress("quantity", &quantity);
+      tree->SetBranchAddress("min", &vmin);
+      tree->SetBranchAddress("max", &vmax);
+      tree->SetBranchAddress("n", &n);
+      tree->SetBranchAddress("mean", means.data());
+      tree->SetBranchAddress("weight", weights.data());
+      for (Long64_t e = 0; e < tree->GetEntries(); e++) {
+        tree->GetEntry(e);
+        if (quantity < 0 || quantity >= (Int_t)fQuantities.size()) continue;
+        QuantileSketch part(fCompression);
+        for (Int_t k = 0; k < n; k++) part.fBuffer.push_back({ means[k], weights[k] });
+        part.fMin = vmin;
+        part.fMax = vmax;
+        part.Compress();
+        Slot(bin)[quantity].Merge(part);
+      }
+      tree->ResetBranchAddresses();
+      return true;
+    }
+
+    // Axes and quantities stored with a sketch tree
+    static bool Describe(TTree* tree, AxisSet& axes, std::vector<std::string>& quantities) {
+      TNamed* a = tree ? (TNamed*)tree->GetUserInfo()->FindObject("axes") : nullptr;
+      TNamed* q = tree ? (TNamed*)tree->GetUserInfo()->FindObject("quantities") : nullptr;
+      if (!a || !q) return false;
+      std::vector<AxisSpec> specs;
+      TObjArray* toks = TString(a->GetTitle()).Tokenize(";");
+      for (int i = 0; i < toks->GetEntries(); i++) {
+        char name[64];
+        int nb;
+        double lo, hi;
+        if (sscanf(((TObjString*)toks->At(i))->GetString().Data(), "%63s %d %lf %lf", name, &nb, &lo, &hi) == 4) specs.push_back(AxisSpec(name, nb, lo, hi));
+      }
+      delete toks;
+      toks = TString(q->GetTitle()).Tokenize(";");
+      quantities.clear();
+      for (int i = 0; i < toks->GetEntries(); i++) quantities.push_back(((TObjString*)toks->At(i))->GetString().Data());
+      delete toks;
+      axes = AxisSet(specs);
+      return true;
+    }
+
+  private:
+
+    std::vector<QuantileSketch>& Slot(Long64_t bin) {
+      auto it = fBins.find(bin);
+      if (it == fBins.end()) it = fBins.emplace(bin, std::vector<QuantileSketch>(fQuantities.size(), QuantileSketch(fCompression))).first;
+      return it->second;
+    }
+
+    AxisSet fAxes;
+    std::vector<std::string> fQuantities;
+    double fCompression;
+    std::unordered_map<Long64_t, std::vector<QuantileSketch>> fBins;
+    std::vector<Int_t> fCoord;
+
+};
+
+#endif
@@ -0,0 +1,280 @@
+#ifndef RATIO_ENGINE_H
+#define RATIO_ENGINE_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+
+#include "TH1D.h"
+#include "TTree.h"
+#include "TSpline.h"
+#include "TString.h"
+#include "TDirectory.h"
+
+
+/*
+
+  Data/MC ratios and their splines for all planes, TPCs and variables at once
+
+  make_spline_1d.C opens both files per variable and clones/divides one TH1D
+  per plane at a time. RatioEngine instead loads every (variable, quantity,
+  plane/TPC) profile pair into flat arrays (x, data, data error, mc, mc
+  error, one series after the other), computes every ratio and its error in
+  one loop over all bins, and fits the splines of all series on a pool of
+  threads:
+
+    r = d / m,   dr = |r| sqrt((dd / d)^2 + (dm / m)^2)   (TH1::Divide errors)
+    r = dr = 0 where d or m is 0, and those bins are left out of the spline
+
+  The spline is the cubic smoothing spline minimising
+    sum ((r_i - g_i) / dr_i)^2 + alpha * integral g''^2
+  (Reinsch, banded Cholesky). alpha = 0 interpolates the ratios like
+  make_spline_1d.C; alpha > 0 smooths them with the errors as weights, and
+  the spline written is the natural cubic spline through the smoothed
+  values, which is the same curve.
+
+  Write() puts, per variable directory, h_<q>_ratio_<idx> and spline_<q>_<idx>
+  (the names make_spline_1d.C uses) plus one flat "ratio_table" tree.
+
+*/
+
+// Smoothed values g of the cubic smoothing spline through (x, y) with
+// weights w (1 / sigma^2); alpha = 0 returns y
+inline void smoothing_spline(const double* x, const double* y, const double* w, size_t n, double alpha, double* g) {
+  for (size_t i = 0; i < n; i++) g[i] = y[i];
+  if (alpha <= 0 || n < 3) return;
+  size_t m = n - 2;
+  std::vector<double> h(n - 1);
+  for (size_t i = 0; i + 1 < n; i++) h[i] = x[i + 1] - x[i];
+  // Q (n x m, 3 non-zeros per column j: rows j, j+1, j+2) and Q^T y
+  std::vector<double> q0(m), q1(m), q2(m), qty(m);
+  for (size_t j = 0; j < m; j++) {
+    q0[j] = 1. / h[j];
+    q1[j] = -1. / h[j] - 1. / h[j + 1];
+    q2[j] = 1. / h[j + 1];
+    qty[j] = q0[j] * y[j] + q1[j] * y[j + 1] + q2[j] * y[j + 2];
+  }
+  // A = R + alpha Q^T W^-1 Q, symmetric pentadiagonal: a0 diagonal, a1/a2 off diagonals
+  std::vector<double> a0(m), a1(m, 0.), a2(m, 0.);
+  for (size_t j = 0; j < m; j++) {
+    a0[j] = (h[j] + h[j + 1]) / 3. + alpha * (q0[j] * q0[j] / w[j] + q1[j] * q1[j] / w[j + 1] + q2[j] * q2[j] / w[j + 2]);
+    if (j + 1 < m) a1[j] = h[j + 1] / 6. + alpha * (q1[j] * q0[j + 1] / w[j + 1] + q2[j] * q1[j + 1] / w[j + 2]);
+    if (j + 2 < m) a2[j] = alpha * q2[j] * q0[j + 2] / w[j + 2];
+  }
+  // banded Cholesky A = L D L^T
+  std::vector<double> d(m), l1(m, 0.), l2(m, 0.);
+  for (size_t j = 0; j < m; j++) {
+    d[j] = a0[j];
+    if (j >= 1) d[j] -= l1[j - 1] * l1[j - 1] * d[j - 1];
+    if (j >= 2) d[j] -= l2[j - 2] * l2[j - 2] * d[j - 2];
+    if (j + 1 < m) {
+      l1[j] = a1[j];
+      if (j >= 1) l1[j] -= l2[j - 1] * l1[j - 1] * d[j - 1];
+      l1[j] /= d[j];
+    }
+    if (j + 2 < m) l2[j] = a2[j] / d[j];
+  }
+  std::vector<double> gamma(m);
+  for (size_t j = 0; j < m; j++) {
+    gamma[j] = qty[j];
+    if (j >= 1) gamma[j] -= l1[j - 1] * gamma[j - 1];
+    if (j >= 2) gamma[j] -= l2[j - 2] * gamma[j - 2];
+  }
+  for (size_t j = 0; j < m; j++) gamma[j] /= d[j];
+  for (size_t jj = m; jj-- > 0;) {
+    if (jj + 1 < m) gamma[jj] -= l1[jj] * gamma[jj + 1];
+    if (jj + 2 < m) gamma[jj] -= l2[jj] * gamma[jj + 2];
+  }
+  // g = y - alpha W^-1 Q gamma
+  for (size_t j = 0; j < m; j++) {
+    g[j] -= alpha * q0[j] * gamma[j] / w[j];
+    g[j + 1] -= alpha * q1[j] * gamma[j] / w[j + 1];
+    g[j + 2] -= alpha * q2[j] * gamma[j] / w[j + 2];
+  }
+}
+
+
+class RatioEngine {
+
+  public:
+
+    struct Series {
+      std::string label;     // variable (x, txz, ...)
+      std::string quantity;  // q, w
+      int idx;               // plane + 3 * tpc
+      size_t offset;         // first bin in the flat arrays
+      size_t n;
+      std::vector<double> edges;
+      std::string xtitle, ytitle;
+    };
+
+    // data and mc must have the same binning
+    bool Add(const std::string& label, const std::string& quantity, int idx, const TH1* data, const TH1* mc) {
+      if (!data || !mc || data->GetNbinsX() != mc->GetNbinsX()) {
+        std::cerr << "RatioEngine: missing or incompatible " << quantity << idx << " for " << label << std::endl;
+        return false;
+      }
+      Series s;
+      s.label = label;
+      s.quantity = quantity;
+      s.idx = idx;
+      s.offset = fX.size();
+      s.n = data->GetNbinsX();
+      s.ytitle = data->GetYaxis()->GetTitle();
+      for (int b = 1; b <= (int)s.n; b++) {
+        s.edges.push_back(data->GetXaxis()->GetBinLowEdge(b));
+        fX.push_back(data->GetXaxis()->GetBinCenter(b));
+        fData.push_back(data->GetBinContent(b));
+        fDataErr.push_back(data->GetBinError(b));
+        fMC.push_back(mc->GetBinContent(b));
+        fMCErr.push_back(mc->GetBinError(b));
+      }
+      s.edges.push_back(data->GetXaxis()->GetBinUpEdge(s.n));
+      fSeries.push_back(s);
+      return true;
+    }
+
+    size_t NSeries() const { return fSeries.size(); }
+    size_t NBins() const { return fX.size(); }
+
+    // All ratios in one pass
+    void Compute() {
+      size_t n = fX.size();
+      fRatio.resize(n);
+      fRatioErr.resize(n);
+      const double* d = fData.data();
+      const double* dd = fDataErr.data();
+      const double* m = fMC.data();
+      const double* dm = fMCErr.data();
+      double* r = fRatio.data();
+      double* dr = fRatioErr.data();
+      for (size_t i = 0; i < n; i++) {
+        bool ok = (d[i] != 0.) && (m[i] != 0.);
+        double ri = ok ? d[i] / m[i] : 0.;
+        double ed = ok ? dd[i] / d[i] : 0.;
+        double em = ok ? dm[i] / m[i] : 0.;
+        r[i] = ri;
+        dr[i] = std::fabs(ri) * std::sqrt(ed * ed + em * em);
+      }
+    }
+
+    // Smoothing splines of all series on nthreads threads (0: all cores)
+    void Fit(double alpha = 0., unsigned nthreads = 0) {
+      if (fRatio.size() != fX.size()) Compute();
+      fSmooth.assign(fX.size(), 0.);
+      fKnots.assign(fSeries.size(), std::vector<size_t>());
+      if (nthreads == 0) nthreads = std::max(1u, std::thread::hardware_concurrency());
+      nthreads = std::min<unsigned>(nthreads, std::max<size_t>(fSeries.size(), 1));
+      std::atomic<size_t> next(0);
+      auto worker = [&]() {
+        std::vector<double> xs, ys, ws, gs;
+        for (size_t k = next++; k < fSeries.size(); k = next++) {
+          const Series& s = fSeries[k];
+          xs.clear(); ys.clear(); ws.clear();
+          std::vector<size_t>& knots = fKnots[k];
+          for (size_t i = s.offset; i < s.offset + s.n; i++) {
+            // ignore empty bins, as make_spline_1d.C does
+            if (!(fRatio[i] > 0)) continue;
+            knots.push_back(i);
+            xs.push_back(fX[i]);
+            ys.push_back(fRatio[i]);
+            ws.push_back(fRatioErr[i] > 0 ? 1. / (fRatioErr[i] * fRatioErr[i]) : 1.);
+          }
+          gs.resize(xs.size());
+          smoothing_spline(xs.data(), ys.data(), ws.data(), xs.size(), alpha, gs.data());
+          for (size_t j = 0; j < knots.size(); j++) fSmooth[knots[j]] = gs[j];
+        }
+      };
+      std::vector<std::thread> pool;
+      for (unsigned t = 1; t < nthreads; t++) pool.emplace_back(worker);
+      worker();
+      for (std::thread& t : pool) t.join();
+      fAlpha = alpha;
+    }
+
+    void Write(TDirectory* out) {
+      for (size_t k = 0; k < fSeries.size(); k++) {
+        const Series& s = fSeries[k];
+        TDirectory* dir = out->GetDirectory(s.label.c_str());
+        if (!dir) dir = out->mkdir(s.label.c_str());
+        dir->cd();
+        TH1D* h = new TH1D(Form("h_%s_ratio_%d", s.quantity.c_str(), s.idx), "", s.n, s.edges.data());
+        h->SetDirectory(0);
+        h->GetXaxis()->SetTitle(s.label.c_str());
+        h->GetYaxis()->SetTitle(s.ytitle.c_str());
+        for (size_t i = 0; i < s.n; i++) {
+          h->SetBinContent(i + 1, fRatio[s.offset + i]);
+          h->SetBinError(i + 1, fRatioErr[s.offset + i]);
+        }
+        h->Write();
+        delete h;
+        const std::vector<size_t>& knots = fKnots[k];
+        if (knots.size() < 2) continue;
+        std::vector<double> xs, gs;
+        for (size_t i : knots) {
+          xs.push_back(fX[i]);
+          gs.push_back(fSmooth[i]);
+        }
+        TSpline3* spline = (fAlpha > 0) ? new TSpline3(Form("spline_%s_%d", s.quantity.c_str(), s.idx), xs.data(), gs.data(), xs.size(), "b2e2", 0., 0.)
+                                        : new TSpline3(Form("spline_%s_%d", s.quantity.c_str(), s.idx), xs.data(), gs.data(), xs.size());
+        spline->SetName(Form("spline_%s_%d", s.quantity.c_str(), s.idx));
+        spline->SetLineColor(kRed);
+        spline->SetLineWidth(2);
+        spline->Write(spline->GetName());
+        delete spline;
+      }
+      out->cd();
+      WriteTable();
+    }
+
+  private:
+
+    void WriteTable() {
+      TTree* tree = new TTree("ratio_table", "Data/MC ratios of all variables, planes and TPCs (RatioEngine.h)");
+      char label[64], quantity[8];
+      Int_t idx, bin;
+      Double_t x, d, dd, m, dm, r, dr, g;
+      tree->Branch("label", label, "label/C");
+      tree->Branch("quantity", quantity, "quantity/C");
+      tree->Branch("idx", &idx, "idx/I");
+      tree->Branch("bin", &bin, "bin/I");
+      tree->Branch("x", &x, "x/D");
+      tree->Branch("data", &d, "data/D");
+      tree->Branch("data_err", &dd, "data_err/D");
+      tree->Branch("mc", &m, "mc/D");
+      tree->Branch("mc_err", &dm, "mc_err/D");
+      tree->Branch("ratio", &r, "ratio/D");
+      tree->Branch("ratio_err", &dr, "ratio_err/D");
+      tree->Branch("smooth", &g, "smooth/D");
+      for (const Series& s : fSeries) {
+        snprintf(label, sizeof(label), "%s", s.label.c_str());
+        snprintf(quantity, sizeof(quantity), "%s", s.quantity.c_str());
+        idx = s.idx;
+        for (size_t i = 0; i < s.n; i++) {
+          size_t k = s.offset + i;
+          bin = i + 1;
+          x = fX[k];
+          d = fData[k]; dd = fDataErr[k];
+          m = fMC[k]; dm = fMCErr[k];
+          r = fRatio[k]; dr = fRatioErr[k];
+          g = fSmooth.empty() ? 0. : fSmooth[k];
+          tree->Fill();
+        }
+      }
+      tree->Write();
+      delete tree;
+    }
+
+    std::vector<Series> fSeries;
+    std::vector<double> fX, fData, fDataErr, fMC, fMCErr;
+    std::vector<double> fRatio, fRatioErr, fSmooth;
+    std::vector<std::vector<size_t>> fKnots;
+    double fAlpha = 0.;
+
+};
+
+#endif
@@ -31,27 +31,22 @@ const double data_fit[6][4] = {
     {2.0, 0.00015509413830139263, 4.500935862965873e-08, 3.597088664976742e-12}
 };
 
+// Pathological width threshold: [0] + [1]*x^2 + [2]*x^4 + [3]*x^6 in txz (deg)
+// Same expression the TF1 used to evaluate, without building a TF1 per hit
+float txz_cut_threshold(float txz, unsigned idx, bool isData) {
+
+  const double* p = (isData) ? data_fit[idx] : mc_fit[idx];
+  double x = txz;
+  float y = p[0] + p[1]*x*x + p[2]*x*x*x*x + p[3]*x*x*x*x*x*x;
+  return y;
+
+}
+
 bool txz_cut(float txz, float width, unsigned idx, bool isData) {
 
-  TF1 *func = new TF1(Form("fit_%d", idx), "[0] + [1]*x*x + [2]*x*x*x*x + [3]*x*x*x*x*x*x", -90, 90);
-  if (isData) {
-    for (int i = 0; i < 4; ++i) {
-      func->SetParameter(i, data_fit[idx][i]);
-    }
-    float y = func->Eval(txz);
-    delete func;
-    if (width < y) return true;
-    return false;
-  }
-  else {
-    for (int i = 0; i < 4; ++i) {
-      func->SetParameter(i, mc_fit[idx][i]);
-    }
-    float y = func->Eval(txz);
-    delete func;
-    if (width < y) return true;
-    return false;
-  }
+  float y = txz_cut_threshold(txz, idx, isData);
+  if (width < y) return true;
+  return false;
 
 }
 
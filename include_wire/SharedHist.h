@@ -0,0 +1,334 @@
+#ifndef SHARED_HIST_H
+#define SHARED_HIST_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <cstring>
+#include <cstdint>
+#include <ctime>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "THnSparse.h"
+
+#include "AxisSpec.h"
+
+
+/*
+
+  Shared memory histogram accumulation for the workers of one node (WIREMOD_SHM)
+
+  N local worker processes (same filler arguments up to the entry range) map
+  one region /dev/shm/<name> and add their hit counts to it instead of each
+  holding its own THnSparse set. The region is an open addressing hash table
+  of (histogram id, linear bin) -> count: a new bin claims its slot with one
+  compare-and-swap on the key, counts are atomic adds, so fills never take a
+  lock. A small extra block (the cut flows) is merged once per worker under a
+  spin lock.
+
+  The first worker creates and sizes the region (WIREMOD_SHM_MB), the others
+  wait for it and check the layout fingerprint (axes, variants). Finish()
+  waits until every worker has finished or is gone (its process exited
+  without Finish, or it never attached within the timeout); one of the
+  finished workers then turns the table into THnSparse and writes them, and
+  removes the region, so a local run needs no merge and one failed worker
+  does not cost the others' output. The lock is held by a pid and taken over
+  from a worker that died holding it.
+
+  Inserts stop at 7/8 of the slots. Fill() then returns false and the caller
+  keeps the bin in its own histograms (written in its own output).
+
+*/
+
+const char kSharedHistMagic[8] = { 'W', 'M', 'S', 'H', 'H', 'I', 'S', 'T' };
+const uint32_t kSharedHistVersion = 2;
+const uint32_t kSharedHistMaxWorkers = 256;
+
+struct SharedHistHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t nworkers;
+  uint64_t layout;      // fingerprint of the axes / histograms all workers fill
+  uint64_t nhists;
+  uint64_t capacity;    // slots, power of two
+  uint64_t extra_bytes; // after the header, before the slots
+  std::atomic<uint32_t> ready;
+  std::atomic<uint32_t> attached;
+  std::atomic<uint32_t> finished;
+  std::atomic<uint32_t> overflowed; // workers with bins that did not fit
+  std::atomic<uint32_t> collector;  // set by the worker that writes the table
+  std::atomic<int32_t> lock;        // pid of the holder, 0 = free
+  std::atomic<uint64_t> used;       // occupied slots
+  std::atomic<int32_t> pid[kSharedHistMaxWorkers];   // by attach order, 0 = not attached yet
+  std::atomic<uint32_t> state[kSharedHistMaxWorkers]; // 0 filling, 1 finished, 2 left without Finish
+};
+
+struct SharedHistSlot {
+  std::atomic<uint64_t> key;    // bin * nhists + hist + 1, 0 = empty
+  std::atomic<uint64_t> count;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "SharedHist needs lock-free 64 bit atomics");
+
+
+class SharedHists {
+
+  public:
+
+    ~SharedHists() { Close(false); }
+
+    // FNV-1a of a description of the histograms, equal for every worker
+    static uint64_t Fingerprint(const std::string& s) {
+      uint64_t h = 1469598103934665603ULL;
+      for (unsigned char c : s) { h ^= c; h *= 1099511628211ULL; }
+      return h;
+    }
+
+    // Create or join /dev/shm/<name>; every worker passes the same arguments
+    bool Open(const std::string& name, unsigned nworkers, uint64_t nhists, double size_mb,
+              uint64_t layout, size_t extra_bytes, int timeout_s = 300) {
+      fPath = "/dev/shm/" + name;
+      size_t header = Align(sizeof(SharedHistHeader));
+      size_t extra = Align(extra_bytes);
+      uint64_t capacity = 1;
+      while (header + extra + 2 * capacity * sizeof(SharedHistSlot) <= size_mb * 1024. * 1024.) capacity *= 2;
+      if (nworkers == 0 || nworkers > kSharedHistMaxWorkers) {
+        std::cerr << "SharedHists: " << nworkers << " workers, at most " << kSharedHistMaxWorkers << std::endl;
+        return false;
+      }
+      if (capacity < 1024) {
+        std::cerr << "SharedHists: WIREMOD_SHM_MB=" << size_mb << " is too small" << std::endl;
+        return false;
+      }
+      fSize = header + extra + capacity * sizeof(SharedHistSlot);
+
+      bool creator = true;
+      int fd = open(fPath.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+      if (fd < 0) {
+        creator = false;
+        fd = open(fPath.c_str(), O_RDWR);
+      }
+      if (fd < 0) {
+        std::cerr << "SharedHists: could not open " << fPath << std::endl;
+        return false;
+      }
+      if (creator && ftruncate(fd, fSize) != 0) {
+        std::cerr << "SharedHists: could not size " << fPath << " to " << fSize << " bytes" << std::endl;
+        close(fd);
+        unlink(fPath.c_str());
+        return false;
+      }
+      // joiners wait for the creator's ftruncate
+      off_t size = -1;
+      time_t start = time(nullptr);
+      while (true) {
+        struct stat st;
+        size = (fstat(fd, &st) == 0) ? st.st_size : -1;
+        if (size < 0 || (size_t)size >= fSize || time(nullptr) - start >= timeout_s) break;
+        usleep(10000);
+      }
+      if (size < 0 || (size_t)size != fSize) {
+        if (size < 0) std::cerr << "SharedHists: could not stat " << fPath << std::endl;
+        else std::cerr << "SharedHists: " << fPath << " has " << (long long)size << " bytes, expected " << fSize
+                       << " (different WIREMOD_SHM_MB or a stale region?)" << std::endl;
+        close(fd);
+        return false;
+      }
+      void* p = mmap(nullptr, fSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      close(fd);
+      if (p == MAP_FAILED) {
+        std::cerr << "SharedHists: mmap of " << fPath << " failed" << std::endl;
+        return false;
+      }
+      fBase = (char*)p;
+      fHeader = (SharedHistHeader*)fBase;
+      fExtra = fBase + header;
+      fSlots = (SharedHistSlot*)(fBase + header + extra);
+
+      if (creator) {
+        // the file is zero filled: empty slots, zero atomics
+        std::memcpy(fHeader->magic, kSharedHistMagic, 8);
+        fHeader->version = kSharedHistVersion;
+        fHeader->nworkers = nworkers;
+        fHeader->layout = layout;
+        fHeader->nhists = nhists;
+        fHeader->capacity = capacity;
+        fHeader->extra_bytes = extra_bytes;
+        fHeader->ready.store(1, std::memory_order_release);
+      }
+      start = time(nullptr);
+      while (fHeader->ready.load(std::memory_order_acquire) == 0 && time(nullptr) - start < timeout_s) usleep(10000);
+      if (fHeader->ready.load(std::memory_order_acquire) == 0 || std::memcmp(fHeader->magic, kSharedHistMagic, 8) != 0 ||
+          fHeader->version != kSharedHistVersion || fHeader->layout != layout || fHeader->nhists != nhists ||
+          fHeader->nworkers != nworkers || fHeader->extra_bytes != extra_bytes) {
+        std::cerr << "SharedHists: " << fPath << " was set up for other histograms or worker count" << std::endl;
+        Close(false);
+        return false;
+      }
+      if (fHeader->collector.load() != 0) {
+        std::cerr << "SharedHists: " << fPath << " was already written (stale region? remove it)" << std::endl;
+        Close(false);
+        return false;
+      }
+      uint32_t n = fHeader->attached.fetch_add(1) + 1;
+      if (n > nworkers) {
+        std::cerr << "SharedHists: more than " << nworkers << " workers on " << fPath << " (stale region? remove it)" << std::endl;
+        Close(false);
+        return false;
+      }
+      fWorker = n - 1;
+      fPid = getpid();
+      fHeader->pid[fWorker].store(fPid, std::memory_order_release);
+      fMask = capacity - 1;
+      fLimit = capacity - capacity / 8;
+      printf("SharedHists: %s worker %u of %u, %llu slots (%.0f MB)%s\n", fPath.c_str(), n, nworkers,
+             (unsigned long long)capacity, fSize / 1048576., creator ? ", created" : "");
+      return true;
+    }
+
+    // Adds n to (hist, bin); false if the bin is new and the table is full
+    inline bool Fill(uint64_t hist, uint64_t bin, uint64_t n = 1) {
+      const uint64_t key = bin * fHeader->nhists + hist + 1;
+      for (uint64_t probe = 0, h = Mix(key); probe <= fMask; probe++, h++) {
+        SharedHistSlot& s = fSlots[h & fMask];
+        uint64_t k = s.key.load(std::memory_order_acquire);
+        if (k == 0) {
+          if (fHeader->used.load(std::memory_order_relaxed) >= fLimit) break;
+          if (s.key.compare_exchange_strong(k, key, std::memory_order_acq_rel)) {
+            fHeader->used.fetch_add(1, std::memory_order_relaxed);
+            k = key;
+          }
+        }
+        if (k == key) {
+          s.count.fetch_add(n, std::memory_order_relaxed);
+          return true;
+        }
+      }
+      if (!fOverflow) {
+        fOverflow = true;
+        fHeader->overflowed.fetch_add(1);
+        std::cerr << "SharedHists: " << fPath << " is full --> new bins stay in this worker's histograms (raise WIREMOD_SHM_MB)" << std::endl;
+      }
+      return false;
+    }
+
+    void* Extra() const { return fExtra; }
+
+    // Checks the holder about once a second and takes the lock over if it died
+    void Lock() {
+      int32_t expected = 0;
+      time_t checked = time(nullptr);
+      while (!fHeader->lock.compare_exchange_weak(expected, fPid, std::memory_order_acquire)) {
+        if (expected != 0 && time(nullptr) != checked) {
+          checked = time(nullptr);
+          int32_t holder = expected;
+          if (!Alive(holder) && fHeader->lock.compare_exchange_strong(expected, fPid, std::memory_order_acquire)) {
+            std::cerr << "SharedHists: worker " << holder << " died holding the lock of " << fPath << " --> taken over" << std::endl;
+            return;
+          }
+        }
+        expected = 0;
+        sched_yield();
+      }
+    }
+    void Unlock() { fHeader->lock.store(0, std::memory_order_release); }
+
+    // Marks this worker finished and waits until every worker has finished or
+    // is gone (exited or closed without Finish, or not attached timeout_s
+    // after this call). True for exactly one finished worker, which writes
+    // the table
+    bool Finish(int timeout_s = 300) {
+      fHeader->state[fWorker].store(1, std::memory_order_release);
+      fHeader->finished.fetch_add(1, std::memory_order_acq_rel);
+      fFinished = true;
+      const uint32_t nworkers = fHeader->nworkers;
+      time_t start = time(nullptr);
+      uint32_t gone = 0;
+      while (true) {
+        uint32_t done = 0;
+        gone = 0;
+        for (uint32_t w = 0; w < nworkers; w++) {
+          int32_t pid = fHeader->pid[w].load(std::memory_order_acquire);
+          uint32_t state = fHeader->state[w].load(std::memory_order_acquire);
+          if (pid != 0 && state == 1) done++;
+          else if (pid != 0 ? (state == 2 || !Alive(pid)) : time(nullptr) - start >= timeout_s) gone++;
+        }
+        if (done + gone == nworkers) break;
+        usleep(100000);
+      }
+      if (fHeader->collector.exchange(1, std::memory_order_acq_rel) != 0) return false;
+      if (gone > 0) {
+        std::cerr << "SharedHists: " << gone << " of " << nworkers << " workers did not finish --> the shared histograms miss"
+                  << " (part of) their entries and their cut flows" << std::endl;
+      }
+      return true;
+    }
+
+    bool Overflowed() const { return fOverflow; }
+    uint32_t WorkersOverflowed() const { return fHeader->overflowed.load(); }
+
+    // Adds the table to hists[hist id], all booked with axes
+    void AddTo(const AxisSet& axes, const std::vector<THnSparse*>& hists) const {
+      std::vector<Int_t> coord(axes.NDim());
+      std::vector<double> entries(hists.size(), 0.);
+      for (uint64_t i = 0; i <= fMask; i++) {
+        uint64_t key = fSlots[i].key.load(std::memory_order_acquire);
+        if (key == 0) continue;
+        uint64_t count = fSlots[i].count.load(std::memory_order_relaxed);
+        uint64_t hist = (key - 1) % fHeader->nhists;
+        axes.Coords((key - 1) / fHeader->nhists, coord.data());
+        THnSparse* h = hists[hist];
+        h->AddBinContent(h->GetBin(coord.data()), count);
+        entries[hist] += count;
+      }
+      for (size_t j = 0; j < hists.size(); j++) hists[j]->SetEntries(hists[j]->GetEntries() + entries[j]);
+      printf("SharedHists: %llu of %llu slots used\n", (unsigned long long)fHeader->used.load(), (unsigned long long)(fMask + 1));
+    }
+
+    // The writing worker removes the region; one that leaves without Finish
+    // no longer holds up the others
+    void Close(bool remove) {
+      if (fHeader && fPid != 0 && !fFinished) fHeader->state[fWorker].store(2, std::memory_order_release);
+      if (fBase) munmap(fBase, fSize);
+      if (remove) unlink(fPath.c_str());
+      fBase = nullptr;
+      fHeader = nullptr;
+    }
+
+  private:
+
+    static bool Alive(int32_t pid) { return kill(pid, 0) == 0 || errno == EPERM; }
+
+    static size_t Align(size_t n) { return (n + 63) & ~size_t(63); }
+
+    // splitmix64 finalizer
+    static inline uint64_t Mix(uint64_t x) {
+      x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+      x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+      return x ^ (x >> 31);
+    }
+
+    std::string fPath;
+    size_t fSize = 0;
+    char* fBase = nullptr;
+    SharedHistHeader* fHeader = nullptr;
+    void* fExtra = nullptr;
+    SharedHistSlot* fSlots = nullptr;
+    uint64_t fMask = 0;
+    uint64_t fLimit = 0;
+    uint32_t fWorker = 0;
+    int32_t fPid = 0;
+    bool fOverflow = false;
+    bool fFinished = false;
+
+};
+
+#endif
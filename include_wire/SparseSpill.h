@@ -0,0 +1,146 @@
+#ifndef SPARSE_SPILL_H
+#define SPARSE_SPILL_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cmath>
+
+#include "TFile.h"
+#include "TString.h"
+#include "TSystem.h"
+#include "THnSparse.h"
+
+
+/*
+
+  Memory budget for THnSparse filling
+
+  sparse_mem_estimate() is a cheap estimate of the heap used by a THnSparse:
+  per filled bin the content, the compact coordinate (bits of all axes
+  rounded up to bytes), the sumw2 entry if enabled and the hash map slot.
+  It only reads GetNbins(), so it can be called every few tracks.
+
+  SparseSpiller watches a set of histograms. When their estimate crosses the
+  budget, Check() writes the current partial histograms to a spill file
+  (<output>.spill<N>.root) and resets them. At the end, MergeInto() adds the
+  spills back one histogram at a time, so the peak memory of the final write
+  is one merged histogram instead of all of them at once.
+
+*/
+
+inline size_t sparse_bin_bytes(const THnSparse* h) {
+  int bits = 0;
+  for (int d = 0; d < h->GetNdimensions(); d++) {
+    int n = h->GetAxis(d)->GetNbins() + 2; // with under/overflow
+    bits += (int)std::ceil(std::log2((double)n));
+  }
+  size_t coord = (bits + 7) / 8;
+  size_t content = 8;                                 // THnSparseD
+  size_t sumw2 = (h->GetCalculateErrors()) ? 8 : 0;
+  size_t map = 24;                                    // TExMap slot (hash, key, value)
+  return coord + content + sumw2 + map;
+}
+
+inline double sparse_mem_estimate(const THnSparse* h) {
+  return (double)h->GetNbins() * sparse_bin_bytes(h);
+}
+
+
+class SparseSpiller {
+
+  public:
+
+    // budget_mb <= 0: no spilling, only the running estimate
+    SparseSpiller(double budget_mb, const TString& output_file)
+      : fBudget(budget_mb * 1024. * 1024.), fOutput(output_file) {}
+
+    ~SparseSpiller() { Cleanup(); }
+
+    void Add(THnSparse* h) { fHists.push_back(h); }
+
+    double Estimate() const {
+      double mem = 0;
+      for (const THnSparse* h : fHists) mem += sparse_mem_estimate(h);
+      return mem;
+    }
+
+    double PeakMB() const { return fPeak / (1024. * 1024.); }
+    int NSpills() const { return fSpills.size(); }
+
+    // Call every few tracks. Returns true if the histograms were spilled.
+    bool Check() {
+      double mem = Estimate();
+      if (mem > fPeak) fPeak = mem;
+      if (fBudget <= 0 || mem < fBudget) return false;
+      Spill(mem);
+      return true;
+    }
+
+    void Log(size_t ntracks) const {
+      printf("SparseSpiller: %zu tracks, estimated THnSparse memory %.1f MB (peak %.1f MB, %d spills)\n",
+             ntracks, Estimate() / (1024. * 1024.), PeakMB(), NSpills());
+    }
+
+    // Add every spill of histogram `name` into h (one spill file open at a time)
+    void MergeInto(THnSparse* h, const char* name) const {
+      for (const TString& path : fSpills) {
+        TFile* f = TFile::Open(path, "READ");
+        if (!f || f->IsZombie()) {
+          std::cerr << "SparseSpiller: could not reopen " << path << std::endl;
+          delete f;
+          continue;
+        }
+        THnSparse* hs = (THnSparse*)f->Get(name);
+        if (hs) {
+          h->Add(hs);
+          delete hs;
+        }
+        else std::cerr << "SparseSpiller: " << name << " missing in " << path << std::endl;
+        f->Close();
+        delete f;
+      }
+    }
+
+    // Remove the spill files (after the final output was written)
+    void Cleanup() {
+      for (const TString& path : fSpills) gSystem->Unlink(path);
+      fSpills.clear();
+    }
+
+  private:
+
+    void Spill(double mem) {
+      TString path = fOutput;
+      path.ReplaceAll(".root", "");
+      path += Form(".spill%zu.root", fSpills.size());
+
+      TDirectory* prev = gDirectory;
+      TFile* f = TFile::Open(path, "RECREATE");
+      if (!f || f->IsZombie()) {
+        std::cerr << "SparseSpiller: could not create " << path << ", keeping histograms in memory" << std::endl;
+        fBudget = 0;
+        delete f;
+        return;
+      }
+      f->cd();
+      for (THnSparse* h : fHists) h->Write();
+      f->Close();
+      delete f;
+      if (prev) prev->cd();
+
+      for (THnSparse* h : fHists) h->Reset();
+      fSpills.push_back(path);
+      printf("SparseSpiller: %.1f MB over the %.1f MB budget --> spilled to %s\n",
+             mem / (1024. * 1024.), fBudget / (1024. * 1024.), path.Data());
+    }
+
+    double fBudget;
+    TString fOutput;
+    double fPeak = 0;
+    std::vector<THnSparse*> fHists;
+    std::vector<TString> fSpills;
+
+};
+
+#endif
@@ -0,0 +1,275 @@
+#ifndef SPLINE_TABLE_H
+#define SPLINE_TABLE_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+
+
+/*
+
+  Coefficient tables of the WireMod ratio splines and a batch evaluator
+
+  Plain C++ (no ROOT), so the simulation side can include it as is. The
+  tables are written by macros/Fitting/export_spline_tables.C from the
+  TSpline3 / pol TF1 objects of make_spline_1d.C / make_ratio_splines.C and
+  from 2D ratio maps (Widths2D), and checked there against the ROOT objects.
+
+  1D: segments k = 0 .. n-1 starting at knot x_k,
+        f(x) = a + b dx + c dx^2 + d dx^3,  dx = x - x_k
+      the segment of x is the last knot <= x, clamped to the first/last
+      segment outside (the end polynomials extrapolate, like TSpline3::Eval).
+  2D: tensor product of natural cubic splines over a knot grid, one bicubic
+      f(x, y) = sum_pq C_pq dx^p dy^q per cell, same clamping per axis.
+
+  Segment lookup has no data dependent branches: one multiply for uniform
+  knots, otherwise a binary search with a fixed number of steps, so the
+  batch calls run in straight loops.
+
+  File (little endian):
+    "WMSPLTAB" u32 version, u32 ntables
+    per table: u32 name length, name, u32 kind (1 or 2), then
+      1D: u32 n, x[n], coeff[n][4]
+      2D: u32 nx, u32 ny, x[nx], y[ny], coeff[(nx - 1)(ny - 1)][16]   (all f64)
+
+*/
+
+const char kSplineTableMagic[8] = { 'W', 'M', 'S', 'P', 'L', 'T', 'A', 'B' };
+const uint32_t kSplineTableVersion = 1;
+
+// Index of the last knot <= x among n knots, clamped to [0, nseg - 1]
+struct KnotIndex {
+  std::vector<double> knots;
+  size_t nseg = 0;
+  bool uniform = false;
+  double x0 = 0., inv_dx = 0.;
+  unsigned steps = 0;
+
+  void Set(const std::vector<double>& k, size_t segments) {
+    knots = k;
+    nseg = segments;
+    uniform = false;
+    if (knots.size() >= 2) {
+      double dx = (knots.back() - knots.front()) / (knots.size() - 1);
+      uniform = dx > 0;
+      for (size_t i = 0; i < knots.size() && uniform; i++) {
+        uniform = std::fabs(knots[i] - (knots.front() + i * dx)) <= 1e-9 * std::fabs(dx) * knots.size();
+      }
+      x0 = knots.front();
+      inv_dx = (dx > 0) ? 1. / dx : 0.;
+    }
+    steps = 0;
+    while ((size_t(1) << steps) < nseg) steps++;
+  }
+
+  inline size_t Find(double x) const {
+    if (uniform) {
+      double u = (x - x0) * inv_dx;
+      u = u < 0. ? 0. : u;
+      u = u > double(nseg - 1) ? double(nseg - 1) : u;
+      size_t k = (size_t)u;
+      // rounding at a knot: step back if the knot is above x
+      k -= (k > 0) & (knots[k] > x);
+      return k;
+    }
+    size_t base = 0;
+    size_t len = nseg;
+    for (unsigned s = 0; s < steps; s++) {
+      size_t half = len >> 1;
+      base = (knots[base + half] <= x) ? base + half : base;
+      len -= half;
+    }
+    return base;
+  }
+};
+
+
+class SplineTable1D {
+
+  public:
+
+    SplineTable1D() {}
+    // x[k], coeff[4k .. 4k+3] = a, b, c, d of segment k
+    SplineTable1D(const std::vector<double>& x, const std::vector<double>& coeff) : fX(x), fCoeff(coeff) {
+      fIndex.Set(fX, fX.size());
+    }
+
+    size_t NSegments() const { return fX.size(); }
+    const std::vector<double>& Knots() const { return fX; }
+    const std::vector<double>& Coeff() const { return fCoeff; }
+
+    inline double Eval(double x) const {
+      size_t k = fIndex.Find(x);
+      const double* c = &fCoeff[4 * k];
+      double dx = x - fX[k];
+      return c[0] + dx * (c[1] + dx * (c[2] + dx * c[3]));
+    }
+
+    void Eval(const double* x, double* out, size_t n) const {
+      for (size_t i = 0; i < n; i++) out[i] = Eval(x[i]);
+    }
+
+  private:
+
+    std::vector<double> fX;
+    std::vector<double> fCoeff;
+    KnotIndex fIndex;
+
+};
+
+
+class SplineTable2D {
+
+  public:
+
+    SplineTable2D() {}
+    // knots x[nx], y[ny]; coeff[16 * (i * (ny - 1) + j) + 4 * p + q] = C_pq of cell (i, j)
+    SplineTable2D(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& coeff)
+      : fX(x), fY(y), fCoeff(coeff) {
+      fIndexX.Set(fX, fX.size() - 1);
+      fIndexY.Set(fY, fY.size() - 1);
+    }
+
+    const std::vector<double>& KnotsX() const { return fX; }
+    const std::vector<double>& KnotsY() const { return fY; }
+    const std::vector<double>& Coeff() const { return fCoeff; }
+
+    inline double Eval(double x, double y) const {
+      size_t i = fIndexX.Find(x);
+      size_t j = fIndexY.Find(y);
+      const double* c = &fCoeff[16 * (i * (fY.size() - 1) + j)];
+      double dx = x - fX[i];
+      double dy = y - fY[j];
+      double r[4];
+      for (int p = 0; p < 4; p++) r[p] = c[4 * p] + dy * (c[4 * p + 1] + dy * (c[4 * p + 2] + dy * c[4 * p + 3]));
+      return r[0] + dx * (r[1] + dx * (r[2] + dx * r[3]));
+    }
+
+    // e.g. (x, theta) of every simulated hit
+    void Eval(const double* x, const double* y, double* out, size_t n) const {
+      for (size_t k = 0; k < n; k++) out[k] = Eval(x[k], y[k]);
+    }
+
+  private:
+
+    std::vector<double> fX, fY;
+    std::vector<double> fCoeff;
+    KnotIndex fIndexX, fIndexY;
+
+};
+
+
+class SplineTableFile {
+
+  public:
+
+    void Add(const std::string& name, const SplineTable1D& t) { f1D[name] = t; }
+    void Add(const std::string& name, const SplineTable2D& t) { f2D[name] = t; }
+
+    const SplineTable1D* Get1D(const std::string& name) const {
+      auto it = f1D.find(name);
+      return (it == f1D.end()) ? nullptr : &it->second;
+    }
+    const SplineTable2D* Get2D(const std::string& name) const {
+      auto it = f2D.find(name);
+      return (it == f2D.end()) ? nullptr : &it->second;
+    }
+
+    std::vector<std::string> Names() const {
+      std::vector<std::string> n;
+      for (const auto& kv : f1D) n.push_back(kv.first);
+      for (const auto& kv : f2D) n.push_back(kv.first);
+      return n;
+    }
+
+    bool Write(const std::string& path) const {
+      std::ofstream out(path, std::ios::binary);
+      if (!out) {
+        std::cerr << "SplineTableFile: could not create " << path << std::endl;
+        return false;
+      }
+      out.write(kSplineTableMagic, 8);
+      Put<uint32_t>(out, kSplineTableVersion);
+      Put<uint32_t>(out, f1D.size() + f2D.size());
+      for (const auto& kv : f1D) {
+        PutName(out, kv.first);
+        Put<uint32_t>(out, 1);
+        Put<uint32_t>(out, kv.second.NSegments());
+        PutArray(out, kv.second.Knots());
+        PutArray(out, kv.second.Coeff());
+      }
+      for (const auto& kv : f2D) {
+        PutName(out, kv.first);
+        Put<uint32_t>(out, 2);
+        Put<uint32_t>(out, kv.second.KnotsX().size());
+        Put<uint32_t>(out, kv.second.KnotsY().size());
+        PutArray(out, kv.second.KnotsX());
+        PutArray(out, kv.second.KnotsY());
+        PutArray(out, kv.second.Coeff());
+      }
+      return (bool)out;
+    }
+
+    bool Read(const std::string& path) {
+      f1D.clear();
+      f2D.clear();
+      std::ifstream in(path, std::ios::binary);
+      char magic[8];
+      in.read(magic, 8);
+      if (!in || std::memcmp(magic, kSplineTableMagic, 8) != 0 || Get<uint32_t>(in) != kSplineTableVersion) {
+        std::cerr << "SplineTableFile: " << path << " is not a version " << kSplineTableVersion << " spline table" << std::endl;
+        return false;
+      }
+      uint32_t ntables = Get<uint32_t>(in);
+      for (uint32_t t = 0; t < ntables && in; t++) {
+        std::string name = GetName(in);
+        uint32_t kind = Get<uint32_t>(in);
+        if (kind == 1) {
+          uint32_t n = Get<uint32_t>(in);
+          std::vector<double> x = GetArray(in, n), c = GetArray(in, 4 * (size_t)n);
+          f1D[name] = SplineTable1D(x, c);
+        }
+        else if (kind == 2) {
+          uint32_t nx = Get<uint32_t>(in), ny = Get<uint32_t>(in);
+          std::vector<double> x = GetArray(in, nx), y = GetArray(in, ny);
+          std::vector<double> c = GetArray(in, 16 * (size_t)(nx - 1) * (ny - 1));
+          f2D[name] = SplineTable2D(x, y, c);
+        }
+        else break;
+      }
+      if (!in) {
+        std::cerr << "SplineTableFile: " << path << " is truncated" << std::endl;
+        return false;
+      }
+      return true;
+    }
+
+  private:
+
+    template <typename T> static void Put(std::ostream& out, T v) { out.write((const char*)&v, sizeof(T)); }
+    template <typename T> static T Get(std::istream& in) { T v = T(); in.read((char*)&v, sizeof(T)); return v; }
+    static void PutName(std::ostream& out, const std::string& s) { Put<uint32_t>(out, s.size()); out.write(s.data(), s.size()); }
+    static std::string GetName(std::istream& in) {
+      uint32_t n = Get<uint32_t>(in);
+      std::string s(in ? n : 0, '\0');
+      in.read(&s[0], s.size());
+      return s;
+    }
+    static void PutArray(std::ostream& out, const std::vector<double>& a) { out.write((const char*)a.data(), a.size() * sizeof(double)); }
+    static std::vector<double> GetArray(std::istream& in, size_t n) {
+      std::vector<double> a(in ? n : 0);
+      in.read((char*)a.data(), a.size() * sizeof(double));
+      return a;
+    }
+
+    std::map<std::string, SplineTable1D> f1D;
+    std::map<std::string, SplineTable2D> f2D;
+
+};
+
+#endif
@@ -0,0 +1,253 @@
+#ifndef STAGE_TIMER_H
+#define STAGE_TIMER_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <unistd.h>
+
+
+/*
+
+  Stage level timing probes for the fillers
+
+  Compiled out by default. Build with -DWIREMOD_PROFILE (ACLiC:
+  gSystem->AddIncludePath("-DWIREMOD_PROFILE"), or define it before the
+  includes of the macro) to turn them on; otherwise every WIREMOD_PROF_* macro
+  expands to the bare statement / expression and costs nothing.
+
+    WIREMOD_PROF_SCOPE(kStageFill);                     // time until end of scope
+    WIREMOD_PROF_TRACK(run, subrun, evt, track_idx);    // one trace event per track
+    while (WIREMOD_PROF_EXPR(kStageRead, reader.Next()))  // time one expression
+    WIREMOD_PROF_SUMMARY();                             // table at the end of the job
+
+  Each thread accumulates into its own StageStats (no locking in the hot
+  path); the summary merges them. Note that TTreeReader reads branches lazily,
+  so kStageRead is only the entry bookkeeping: the basket reads show up in the
+  stage that first touches an array (kStageLoad / kStageSelect).
+
+  WIREMOD_TRACE=<file.json> additionally records every probe as a Chrome
+  trace-event ("X" complete events, microseconds) that can be opened with
+  chrome://tracing or ui.perfetto.dev. Track events carry run/subrun/evt in
+  their args, so slow tracks can be picked out directly.
+  WIREMOD_TRACE_MAX caps the number of events per thread (default 1000000).
+
+*/
+
+enum Stage {
+  kStageSetup = 0,  // calibration maps
+  kStageRead,       // TTreeReader::Next
+  kStageSelect,     // track level selection
+  kStageAngles,     // plane angles and pathological thresholds
+  kStageLoad,       // copy hit arrays (TTreeReaderArray reads)
+  kStageHitMask,    // hit quality cuts
+  kStageSCE,        // SCE position/pitch correction
+  kStageYZ,         // YZ non-uniformity
+  kStageLifetime,   // electron lifetime
+  kStageFill,       // THnSparse fills
+  kStageWrite,      // output Write()
+  kStageTrack,      // whole track (contains the stages above)
+  kNStages
+};
+
+const char* const kStageNames[kNStages] = {
+  "setup", "read", "select", "angles", "load", "hit_mask", "sce", "yz",
+  "lifetime", "fill", "write", "track"
+};
+
+
+namespace wiremod_prof {
+
+  typedef std::chrono::steady_clock Clock;
+
+  inline Clock::time_point Epoch() {
+    static const Clock::time_point t0 = Clock::now();
+    return t0;
+  }
+
+  inline int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - Epoch()).count();
+  }
+
+  struct TraceEvent {
+    int stage;
+    int64_t ts;  // ns since Epoch()
+    int64_t dur; // ns
+    int run, subrun, evt;   // only for kStageTrack
+    int64_t track;          // global entry, only for kStageTrack
+  };
+
+  struct StageStats {
+    uint64_t calls[kNStages] = {};
+    int64_t total[kNStages] = {};
+    int64_t max[kNStages] = {};
+    unsigned tid = 0;
+    std::vector<TraceEvent> trace;
+
+    inline void Add(int s, int64_t dur) {
+      calls[s]++;
+      total[s] += dur;
+      if (dur > max[s]) max[s] = dur;
+    }
+  };
+
+  // Global registry of the per-thread stats
+  struct Registry {
+    std::mutex mtx;
+    std::vector<StageStats*> threads;
+    std::string trace_file;
+    size_t trace_max = 1000000;
+
+    Registry() {
+      Epoch();
+      if (getenv("WIREMOD_TRACE")) trace_file = getenv("WIREMOD_TRACE");
+      if (getenv("WIREMOD_TRACE_MAX")) trace_max = strtoul(getenv("WIREMOD_TRACE_MAX"), nullptr, 10);
+    }
+
+    ~Registry() {
+      for (StageStats* s : threads) delete s;
+    }
+
+    bool Tracing() const { return !trace_file.empty(); }
+  };
+
+  inline Registry& Reg() {
+    static Registry reg;
+    return reg;
+  }
+
+  inline StageStats& Local() {
+    thread_local StageStats* stats = nullptr;
+    if (!stats) {
+      Registry& reg = Reg();
+      std::lock_guard<std::mutex> lock(reg.mtx);
+      stats = new StageStats();
+      stats->tid = reg.threads.size();
+      reg.threads.push_back(stats);
+    }
+    return *stats;
+  }
+
+  class Scope {
+
+    public:
+
+      Scope(int stage, int run = -1, int subrun = -1, int evt = -1, int64_t track = -1)
+        : fStage(stage), fRun(run), fSubrun(subrun), fEvt(evt), fTrack(track), fStart(NowNs()) {}
+
+      ~Scope() {
+        int64_t dur = NowNs() - fStart;
+        StageStats& s = Local();
+        s.Add(fStage, dur);
+        if (Reg().Tracing() && s.trace.size() < Reg().trace_max) {
+          s.trace.push_back({fStage, fStart, dur, fRun, fSubrun, fEvt, fTrack});
+        }
+      }
+
+    private:
+
+      int fStage;
+      int fRun, fSubrun, fEvt;
+      int64_t fTrack;
+      int64_t fStart;
+
+  };
+
+  template <typename F>
+  inline auto Timed(int stage, F&& f) -> decltype(f()) {
+    Scope scope(stage);
+    return f();
+  }
+
+  // Merge all threads and print one line per stage
+  inline void Summary() {
+    Registry& reg = Reg();
+    std::lock_guard<std::mutex> lock(reg.mtx);
+
+    StageStats sum;
+    for (const StageStats* s : reg.threads) {
+      for (int k = 0; k < kNStages; k++) {
+        sum.calls[k] += s->calls[k];
+        sum.total[k] += s->total[k];
+        sum.max[k] = std::max(sum.max[k], s->max[k]);
+      }
+    }
+
+    // share of the wall time: exclusive stages against everything but "track"
+    int64_t all = 0;
+    for (int k = 0; k < kNStages; k++) if (k != kStageTrack) all += sum.total[k];
+
+    printf("------------------------- Stage Timing (%zu thread%s) -------------------------\n",
+           reg.threads.size(), reg.threads.size() == 1 ? "" : "s");
+    printf("  %-10s %14s %12s %12s %12s %7s\n", "stage", "calls", "total [s]", "mean [us]", "max [ms]", "frac");
+    for (int k = 0; k < kNStages; k++) {
+      if (sum.calls[k] == 0) continue;
+      printf("  %-10s %14llu %12.3f %12.3f %12.3f", kStageNames[k],
+             (unsigned long long)sum.calls[k], sum.total[k] * 1e-9,
+             sum.total[k] * 1e-3 / sum.calls[k], sum.max[k] * 1e-6);
+      if (k == kStageTrack || all == 0) printf(" %7s\n", "-");
+      else printf(" %6.1f%%\n", 100. * sum.total[k] / all);
+    }
+    printf("--------------------------------------------------------------------------------\n");
+
+    if (!reg.Tracing()) return;
+
+    std::ofstream out(reg.trace_file);
+    if (!out) {
+      std::cerr << "StageTimer: could not open trace file " << reg.trace_file << std::endl;
+      return;
+    }
+    int pid = getpid();
+    size_t nevents = 0;
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (const StageStats* s : reg.threads) {
+      for (const TraceEvent& e : s->trace) {
+        if (!first) out << ",\n";
+        first = false;
+        char buf[256];
+        snprintf(buf, sizeof(buf), "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%u",
+                 kStageNames[e.stage], e.ts * 1e-3, e.dur * 1e-3, pid, s->tid);
+        out << buf;
+        if (e.stage == kStageTrack) {
+          snprintf(buf, sizeof(buf), ",\"args\":{\"run\":%d,\"subrun\":%d,\"evt\":%d,\"track\":%lld}",
+                   e.run, e.subrun, e.evt, (long long)e.track);
+          out << buf;
+        }
+        out << "}";
+        nevents++;
+      }
+    }
+    out << "\n]}\n";
+    printf("StageTimer: wrote %zu trace events to %s\n", nevents, reg.trace_file.c_str());
+  }
+
+}
+
+
+#define WIREMOD_PROF_CAT2(a, b) a##b
+#define WIREMOD_PROF_CAT(a, b) WIREMOD_PROF_CAT2(a, b)
+
+#ifdef WIREMOD_PROFILE
+  #define WIREMOD_PROF_SCOPE(stage) \
+    wiremod_prof::Scope WIREMOD_PROF_CAT(wiremod_prof_scope_, __LINE__)(stage)
+  #define WIREMOD_PROF_TRACK(run, subrun, evt, track) \
+    wiremod_prof::Scope WIREMOD_PROF_CAT(wiremod_prof_track_, __LINE__)(kStageTrack, run, subrun, evt, track)
+  #define WIREMOD_PROF_EXPR(stage, expr) (wiremod_prof::Timed(stage, [&]() { return (expr); }))
+  #define WIREMOD_PROF_SUMMARY() wiremod_prof::Summary()
+#else
+  #define WIREMOD_PROF_SCOPE(stage) do {} while (0)
+  #define WIREMOD_PROF_TRACK(run, subrun, evt, track) do {} while (0)
+  #define WIREMOD_PROF_EXPR(stage, expr) (expr)
+  #define WIREMOD_PROF_SUMMARY() do {} while (0)
+#endif
+
+#endif
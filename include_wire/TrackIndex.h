@@ -0,0 +1,282 @@
+#ifndef TRACK_INDEX_H
+#define TRACK_INDEX_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+
+#include "TChain.h"
+#include "TChainElement.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TSystem.h"
+#include "TTreeReader.h"
+#include "TTreeReaderArray.h"
+
+#include "CutFlow.h"
+
+
+/*
+
+  Selected-track index (sidecar per input file)
+
+  Most TrackCaloSkim entries fail selected >= 1, but the fillers still read
+  every entry and the whole collection rr array to find out. The sidecar
+  <input basename>[.<path hash>].trkidx keeps one record per entry with
+  selected >= 1:
+  entry, run/subrun/event, selected, whicht0, the number of collection hits
+  and the track length (last collection rr). Entries without a record are the
+  selected < 1 ones.
+
+  With that, the track selection of the multi dim fillers (life_sel, tpc_sel,
+  crt_sel, no hits, length cut) runs on the index alone and the reader only
+  visits the passing entries. The track cut flow comes out identical: the
+  rejected entries are counted from the index. The length cut is applied when
+  reading, so changing kTrackCut does not need a new index.
+
+  Sidecars are looked up in $WIREMOD_TRACK_INDEX_DIR, or next to a local input.
+  In the common directory the name also carries a hash of the full input path
+  as listed, so equal basenames from different directories do not collide.
+  Build them with macros/Index/build_track_index.C. Every visited entry is
+  checked against the run/subrun/event of its record; on a stale index the
+  filler drops it and reads the rest of its range entry by entry.
+
+*/
+
+const char kTrackIndexMagic[8] = { 'W', 'M', 'T', 'R', 'K', 'I', 'D', 'X' };
+const uint32_t kTrackIndexVersion = 1;
+
+struct TrackIndexHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  int64_t nentries;   // entries of the tree
+  int64_t nrecords;   // entries with selected >= 1
+};
+
+struct TrackIndexRecord {
+  int64_t entry;      // local entry in the file
+  int32_t run;
+  int32_t subrun;
+  int32_t evt;
+  int16_t selected;
+  int16_t whicht0;
+  uint32_t nhits;     // collection plane hits
+  float length;       // rr[2][nhits - 1], 0 without hits
+};
+
+// Track selection of the multi dim fillers
+struct TrackIndexSel {
+  bool life_sel = false;
+  bool tpc_sel = true;
+  bool crt_sel = false;
+  float length_cut = 60.;
+
+  // First failing cut in the filler order, kTrkPassed if none
+  TrackCut Apply(const TrackIndexRecord& r) const {
+    if (life_sel && r.selected != 1) return kTrkLifeSel;
+    if (r.selected < 1) return kTrkSelected;
+    if (tpc_sel && r.whicht0 != 0) return kTrkTPCT0;
+    if (crt_sel && r.whicht0 == 0) return kTrkCRTT0;
+    if (r.nhits == 0) return kTrkNoHits;
+    if (r.length < length_cut) return kTrkLength;
+    return kTrkPassed;
+  }
+};
+
+
+class TrackIndex {
+
+  public:
+
+    // $WIREMOD_TRACK_INDEX_DIR/<basename>.<path hash>.trkidx, or
+    // <basename>.trkidx next to a local input; "" if neither
+    static std::string SidecarPath(const std::string& input) {
+      std::string base = gSystem->BaseName(input.c_str());
+      if (base.size() > 5 && base.compare(base.size() - 5, 5, ".root") == 0) base.resize(base.size() - 5);
+      const char* dir = getenv("WIREMOD_TRACK_INDEX_DIR");
+      if (dir && *dir) {
+        char hash[17];
+        snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)PathHash(input));
+        return std::string(dir) + "/" + base + "." + hash + ".trkidx";
+      }
+      if (input.find("://") != std::string::npos) return "";
+      return std::string(gSystem->GetDirName(input.c_str()).Data()) + "/" + base + ".trkidx";
+    }
+
+    // One pass over the file, reading only the branches the selection needs
+    bool Build(const std::string& input) {
+      fRecords.clear();
+      fEntries = 0;
+      TFile* f = TFile::Open(input.c_str());
+      if (!f || f->IsZombie()) {
+        std::cerr << "TrackIndex: could not open " << input << std::endl;
+        return false;
+      }
+      TTree* tree = (TTree*)f->Get("caloskim/TrackCaloSkim");
+      if (!tree) {
+        std::cerr << "TrackIndex: no caloskim/TrackCaloSkim in " << input << std::endl;
+        delete f;
+        return false;
+      }
+      {
+        TTreeReader reader(tree);
+        TTreeReaderValue<int> run(reader, "meta.run");
+        TTreeReaderValue<int> subrun(reader, "meta.subrun");
+        TTreeReaderValue<int> evt(reader, "meta.evt");
+        TTreeReaderValue<int> selected(reader, "trk.selected");
+        TTreeReaderValue<int> whicht0(reader, "trk.whicht0");
+        TTreeReaderArray<float> rr(reader, "trk.hits2.rr");
+        while (reader.Next()) {
+          if (*selected < 1) continue;
+          TrackIndexRecord r;
+          std::memset(&r, 0, sizeof(r));
+          r.entry = reader.GetCurrentEntry();
+          r.run = *run;
+          r.subrun = *subrun;
+          r.evt = *evt;
+          r.selected = *selected;
+          r.whicht0 = *whicht0;
+          r.nhits = rr.GetSize();
+          r.length = (r.nhits > 0) ? rr[r.nhits - 1] : 0.f;
+          fRecords.push_back(r);
+        }
+        fEntries = tree->GetEntries();
+      }
+      delete f;
+      return true;
+    }
+
+    bool Write(const std::string& path) const {
+      TrackIndexHeader h;
+      std::memset(&h, 0, sizeof(h));
+      std::memcpy(h.magic, kTrackIndexMagic, sizeof(h.magic));
+      h.version = kTrackIndexVersion;
+      h.nentries = fEntries;
+      h.nrecords = fRecords.size();
+      std::string tmp = path + ".tmp";
+      std::ofstream out(tmp, std::ios::binary);
+      out.write((const char*)&h, sizeof(h));
+      out.write((const char*)fRecords.data(), fRecords.size() * sizeof(TrackIndexRecord));
+      out.close();
+      if (!out || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::cerr << "TrackIndex: could not write " << path << std::endl;
+        return false;
+      }
+      return true;
+    }
+
+    bool Read(const std::string& path) {
+      fRecords.clear();
+      fEntries = 0;
+      std::ifstream in(path, std::ios::binary);
+      if (!in) return false;
+      TrackIndexHeader h;
+      in.read((char*)&h, sizeof(h));
+      if (!in || std::memcmp(h.magic, kTrackIndexMagic, sizeof(h.magic)) != 0 || h.version != kTrackIndexVersion) {
+        std::cerr << "TrackIndex: " << path << " is not a version " << kTrackIndexVersion << " index" << std::endl;
+        return false;
+      }
+      fRecords.resize(h.nrecords);
+      in.read((char*)fRecords.data(), h.nrecords * sizeof(TrackIndexRecord));
+      if (!in) {
+        std::cerr << "TrackIndex: " << path << " is truncated" << std::endl;
+        fRecords.clear();
+        return false;
+      }
+      fEntries = h.nentries;
+      return true;
+    }
+
+    Long64_t Entries() const { return fEntries; }
+    const std::vector<TrackIndexRecord>& Records() const { return fRecords; }
+
+  private:
+
+    // FNV-1a of the input path
+    static uint64_t PathHash(const std::string& s) {
+      uint64_t h = 1469598103934665603ULL;
+      for (unsigned char c : s) { h ^= c; h *= 1099511628211ULL; }
+      return h;
+    }
+
+    Long64_t fEntries = 0;
+    std::vector<TrackIndexRecord> fRecords;
+
+};
+
+
+// Indices of all files of a chain, in chain entry numbers
+class ChainTrackIndex {
+
+  public:
+
+    struct Track {
+      Long64_t entry;                 // global chain entry
+      const TrackIndexRecord* record;
+    };
+
+    // False unless every file of the chain has a sidecar
+    bool Load(TChain* chain) {
+      fFiles.clear();
+      fOffsets.assign(1, 0);
+      TObjArray* files = chain->GetListOfFiles();
+      for (int i = 0; i < files->GetEntries(); i++) {
+        const char* name = files->At(i)->GetTitle();
+        std::string path = TrackIndex::SidecarPath(name);
+        fFiles.emplace_back();
+        if (path == "" || gSystem->AccessPathName(path.c_str()) || !fFiles.back().Read(path)) {
+          std::cout << "TrackIndex: no index for " << name << " --> reading all entries" << std::endl;
+          fFiles.clear();
+          return false;
+        }
+        fOffsets.push_back(fOffsets.back() + fFiles.back().Entries());
+      }
+      return !fFiles.empty();
+    }
+
+    // Passing tracks with global entry in [first, last) (last < 0: to the end);
+    // the track cut flow of the whole range goes to cutflow
+    std::vector<Track> Select(const TrackIndexSel& sel, CutFlow& cutflow, Long64_t first = 0, Long64_t last = -1) const {
+      if (last < 0 || last > fOffsets.back()) last = fOffsets.back();
+      std::vector<Track> out;
+      Long64_t nrecords = 0;
+      for (size_t f = 0; f < fFiles.size(); f++) {
+        for (const TrackIndexRecord& r : fFiles[f].Records()) {
+          Long64_t entry = fOffsets[f] + r.entry;
+          if (entry < first || entry >= last) continue;
+          nrecords++;
+          TrackCut c = sel.Apply(r);
+          if (c == kTrkPassed) out.push_back({ entry, &r });
+          else cutflow.Track(c);
+        }
+      }
+      Long64_t nrange = (last > first) ? last - first : 0;
+      cutflow.Track(kTrkAll, nrange);
+      // entries without a record have selected < 1
+      cutflow.Track(sel.life_sel ? kTrkLifeSel : kTrkSelected, nrange - nrecords);
+      printf("TrackIndex: %zu of %lld entries pass the track selection\n", out.size(), nrange);
+      return out;
+    }
+
+    // The reader is at track t: does it match its record?
+    static bool Check(const Track& t, int run, int subrun, int evt) {
+      if (t.record->run == run && t.record->subrun == subrun && t.record->evt == evt) return true;
+      fprintf(stderr, "TrackIndex: entry %lld is %d/%d/%d, index says %d/%d/%d --> stale index, reading all remaining entries\n",
+              (long long)t.entry, run, subrun, evt, t.record->run, t.record->subrun, t.record->evt);
+      return false;
+    }
+
+  private:
+
+    std::vector<TrackIndex> fFiles;
+    std::vector<Long64_t> fOffsets;
+
+};
+
+#endif
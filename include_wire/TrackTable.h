@@ -0,0 +1,201 @@
+#ifndef TRACK_TABLE_H
+#define TRACK_TABLE_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+#include "TChain.h"
+#include "TTree.h"
+#include "TTreeReader.h"
+#include "TTreeReaderValue.h"
+
+#include "CalibNTupleInfo.h"
+#include "HitSelection.h"
+
+
+/*
+
+  Track summary table, filled by the multi dim filler as a by-product
+
+  One row per track that enters the hit loop, with typed columns (TTree
+  "track_table", one branch per column, so uproot/RDataFrame read single
+  columns):
+
+    run, subrun, evt, entry  entry = global chain entry; (run, subrun, evt)
+                             is the join key
+    selected, whicht0
+    sx, sy, sz, ex, ey, ez   track start/end, if the ntuple has trk.start/end
+    dirx, diry, dirz, length length = last collection rr
+    thxz[6], thyz[6]         angles per plane + 3*tpc, as used by the filler
+    nhits[6], nacc[6]        hits loaded / accepted per plane + 3*tpc
+
+  Rows are sorted by (run, subrun, evt, entry) before writing and the tree
+  gets a TTreeIndex on (run, subrun * 1000000 + evt), so notebooks can join
+  on (run, subrun, evt) and do range lookups with a binary search on the
+  sorted columns. There is no packed key column: a 64 bit packing of three
+  32 bit numbers would truncate some of them.
+  Outputs of several jobs are combined (and re-sorted) with
+  macros/Merge/merge_track_tables.C. This replaces the separate
+  tpc_track_scraper.C pass.
+
+*/
+
+struct TrackRow {
+  Long64_t entry;
+  Int_t run;
+  Int_t subrun;
+  Int_t evt;
+  Short_t selected;
+  Short_t whicht0;
+  Float_t sx, sy, sz;
+  Float_t ex, ey, ez;
+  Float_t dirx, diry, dirz;
+  Float_t length;
+  Float_t thxz[6];
+  Float_t thyz[6];
+  UShort_t nhits[6];
+  UShort_t nacc[6];
+};
+
+inline bool track_row_less(const TrackRow& a, const TrackRow& b) {
+  if (a.run != b.run) return a.run < b.run;
+  if (a.subrun != b.subrun) return a.subrun < b.subrun;
+  if (a.evt != b.evt) return a.evt < b.evt;
+  return a.entry < b.entry;
+}
+
+
+class TrackTable {
+
+  public:
+
+    TrackTable() { std::memset(&fRow, 0, sizeof(fRow)); }
+    ~TrackTable() { delete fStartX; delete fStartY; delete fStartZ; delete fEndX; delete fEndY; delete fEndZ; }
+
+    // Start/end are optional: only read if the ntuple has them (the reader
+    // stops on a missing branch). Call before ChainIO::Setup, with
+    // BranchNames() added to its branches.
+    void Attach(TTreeReader& reader, TChain* chain) {
+      if (chain->GetBranch("trk.start.x") && chain->GetBranch("trk.end.x")) {
+        fStartX = new TTreeReaderValue<float>(reader, "trk.start.x");
+        fStartY = new TTreeReaderValue<float>(reader, "trk.start.y");
+        fStartZ = new TTreeReaderValue<float>(reader, "trk.start.z");
+        fEndX = new TTreeReaderValue<float>(reader, "trk.end.x");
+        fEndY = new TTreeReaderValue<float>(reader, "trk.end.y");
+        fEndZ = new TTreeReaderValue<float>(reader, "trk.end.z");
+      }
+      else std::cout << "TrackTable: no trk.start/trk.end in the ntuple, start/end columns are 0" << std::endl;
+    }
+
+    // Branches read by Attach's readers, for the TTreeCache (ChainIO.h)
+    std::vector<std::string> BranchNames() const {
+      if (!fStartX) return {};
+      return { "trk.start.x", "trk.start.y", "trk.start.z", "trk.end.x", "trk.end.y", "trk.end.z" };
+    }
+
+    // Track level columns of the current entry
+    void Begin(MyCalib& my, Long64_t entry) {
+      std::memset(&fRow, 0, sizeof(fRow));
+      fRow.entry = entry;
+      fRow.run = *my.run;
+      fRow.subrun = *my.subrun;
+      fRow.evt = *my.evt;
+      fRow.selected = *my.selected;
+      fRow.whicht0 = *my.whicht0;
+      fRow.dirx = *my.trk_dirx;
+      fRow.diry = *my.trk_diry;
+      fRow.dirz = *my.trk_dirz;
+      size_t n = my.rr[2].GetSize();
+      fRow.length = (n > 0) ? my.rr[2][n - 1] : 0.f;
+      if (fStartX) {
+        fRow.sx = **fStartX; fRow.sy = **fStartY; fRow.sz = **fStartZ;
+        fRow.ex = **fEndX;   fRow.ey = **fEndY;   fRow.ez = **fEndZ;
+      }
+    }
+
+    // Plane columns, after HitMask::Build
+    void Plane(unsigned ip, const float* thxz, const float* thyz, const PlaneHits& hits, const HitMask& mask) {
+      for (unsigned t = 0; t < 2; t++) {
+        fRow.thxz[ip + 3 * t] = thxz[t];
+        fRow.thyz[ip + 3 * t] = thyz[t];
+      }
+      for (size_t i = 0; i < hits.n; i++) fRow.nhits[ip + 3 * (hits.tpc[i] != 0)]++;
+      for (unsigned i : mask.Accepted()) fRow.nacc[ip + 3 * (hits.tpc[i] != 0)]++;
+    }
+
+    void End() { fRows.push_back(fRow); }
+
+    void Add(const TrackRow& row) { fRows.push_back(row); }
+    size_t Size() const { return fRows.size(); }
+
+    // Sort, fill "track_table" in the current directory, build its index
+    void Write(const char* name = "track_table") {
+      std::stable_sort(fRows.begin(), fRows.end(), track_row_less);
+      TTree* tree = new TTree(name, "Track summary (sorted by run, subrun, evt)");
+      TrackRow r;
+      Columns(r, [&](const char* col, void* addr, const char* leaf) { tree->Branch(col, addr, leaf); });
+      for (const TrackRow& row : fRows) {
+        r = row;
+        tree->Fill();
+      }
+      if (tree->GetEntries() > 0) tree->BuildIndex("run", "subrun * 1000000 + evt");
+      tree->Write();
+      printf("TrackTable: wrote %lld tracks to %s\n", tree->GetEntries(), name);
+      delete tree;
+    }
+
+    // Append the rows of a written table (merging job outputs)
+    bool Read(TTree* tree) {
+      if (!tree) return false;
+      TrackRow r;
+      Columns(r, [&](const char* col, void* addr, const char*) { tree->SetBranchAddress(col, addr); });
+      for (Long64_t i = 0; i < tree->GetEntries(); i++) {
+        tree->GetEntry(i);
+        fRows.push_back(r);
+      }
+      tree->ResetBranchAddresses();
+      return true;
+    }
+
+  private:
+
+    template <typename F>
+    static void Columns(TrackRow& r, F column) {
+      column("run", &r.run, "run/I");
+      column("subrun", &r.subrun, "subrun/I");
+      column("evt", &r.evt, "evt/I");
+      column("entry", &r.entry, "entry/L");
+      column("selected", &r.selected, "selected/S");
+      column("whicht0", &r.whicht0, "whicht0/S");
+      column("sx", &r.sx, "sx/F");
+      column("sy", &r.sy, "sy/F");
+      column("sz", &r.sz, "sz/F");
+      column("ex", &r.ex, "ex/F");
+      column("ey", &r.ey, "ey/F");
+      column("ez", &r.ez, "ez/F");
+      column("dirx", &r.dirx, "dirx/F");
+      column("diry", &r.diry, "diry/F");
+      column("dirz", &r.dirz, "dirz/F");
+      column("length", &r.length, "length/F");
+      column("thxz", r.thxz, "thxz[6]/F");
+      column("thyz", r.thyz, "thyz[6]/F");
+      column("nhits", r.nhits, "nhits[6]/s");
+      column("nacc", r.nacc, "nacc[6]/s");
+    }
+
+    TrackRow fRow;
+    std::vector<TrackRow> fRows;
+    TTreeReaderValue<float>* fStartX = nullptr;
+    TTreeReaderValue<float>* fStartY = nullptr;
+    TTreeReaderValue<float>* fStartZ = nullptr;
+    TTreeReaderValue<float>* fEndX = nullptr;
+    TTreeReaderValue<float>* fEndY = nullptr;
+    TTreeReaderValue<float>* fEndZ = nullptr;
+
+};
+
+#endif
@@ -0,0 +1,204 @@
+#ifndef VARIANT_TRAIN_H
+#define VARIANT_TRAIN_H
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+
+#include "HitSelection.h"
+#include "TrackIndex.h"
+
+
+/*
+
+  Selection / calibration variants filled in one pass (WIREMOD_VARIANTS)
+
+  Systematic studies used to be one grid submission of multi_dim_tracks_grid
+  per combination of selection flags and calibrations. A variant train reads
+  the chain once; per track the I/O, angles, hit cut bits and calibration
+  factors are evaluated once, and every variant fills its own histograms
+  from them into its own directory of the output file.
+
+  Variant file, one variant per line, flags not given keep the macro
+  arguments:
+
+    # name       flags
+    nominal
+    no_sce       apply_sce=0
+    crt          tpc_sel=0 crt_sel=1
+    path         pathological_sel=1 apply_recom=0
+
+  Flags: apply_sce apply_yz apply_elife apply_recom tpc_sel crt_sel
+  pathological_sel life_sel. Names become directory names.
+
+  Sharing: the track selection is the first failing cut per variant on the
+  same record (TrackIndexSel); the hit mask is built once with the loosest
+  life_sel / pathological_sel of the train and each variant takes the subset
+  that passes its own reject bits; hit positions and factors are computed
+  once with and once without SCE, only for the settings some variant uses.
+
+*/
+
+struct Variant {
+  std::string name;
+  bool apply_sce = false;
+  bool apply_yz = false;
+  bool apply_elife = false;
+  bool apply_recom = false;
+  bool tpc_sel = true;
+  bool crt_sel = false;
+  bool pathological_sel = false;
+  bool life_sel = false;
+
+  TrackIndexSel TrackSel(float length_cut) const {
+    TrackIndexSel sel;
+    sel.life_sel = life_sel;
+    sel.tpc_sel = tpc_sel;
+    sel.crt_sel = crt_sel;
+    sel.length_cut = length_cut;
+    return sel;
+  }
+
+  HitMaskConfig HitConfig(float thirds_tol) const {
+    HitMaskConfig cfg(thirds_tol);
+    cfg.mult_cut = true;
+    cfg.life_sel = life_sel;
+    cfg.pathological_sel = pathological_sel;
+    return cfg;
+  }
+
+  bool* Flag(const std::string& key) {
+    if (key == "apply_sce") return &apply_sce;
+    if (key == "apply_yz") return &apply_yz;
+    if (key == "apply_elife") return &apply_elife;
+    if (key == "apply_recom") return &apply_recom;
+    if (key == "tpc_sel") return &tpc_sel;
+    if (key == "crt_sel") return &crt_sel;
+    if (key == "pathological_sel") return &pathological_sel;
+    if (key == "life_sel") return &life_sel;
+    return nullptr;
+  }
+
+  void Print() const {
+    printf("  %-16s sce %d yz %d elife %d recom %d | tpc_sel %d crt_sel %d pathological_sel %d life_sel %d\n",
+           name.empty() ? "(top)" : name.c_str(), apply_sce, apply_yz, apply_elife, apply_recom,
+           tpc_sel, crt_sel, pathological_sel, life_sel);
+  }
+};
+
+
+class VariantTrain {
+
+  public:
+
+    // One unnamed variant: the classic single configuration at the top of the file
+    VariantTrain(const Variant& base) : fVariants(1, base) {}
+
+    // Variants of path on top of base; false (and base alone) on a bad file
+    bool Load(const std::string& path, const Variant& base) {
+      std::ifstream in(path);
+      if (!in) {
+        std::cerr << "VariantTrain: could not open " << path << std::endl;
+        return false;
+      }
+      std::vector<Variant> variants;
+      std::string line;
+      while (std::getline(in, line)) {
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.resize(hash);
+        std::istringstream ss(line);
+        Variant v = base;
+        if (!(ss >> v.name)) continue;
+        if (v.name.find('/') != std::string::npos || Find(variants, v.name)) {
+          std::cerr << "VariantTrain: bad or repeated variant name " << v.name << " in " << path << std::endl;
+          return false;
+        }
+        std::string token;
+        while (ss >> token) {
+          size_t eq = token.find('=');
+          bool* flag = (eq == std::string::npos) ? nullptr : v.Flag(token.substr(0, eq));
+          std::string value = (eq == std::string::npos) ? "" : token.substr(eq + 1);
+          if (!flag || (value != "0" && value != "1")) {
+            std::cerr << "VariantTrain: bad flag " << token << " of " << v.name << " (expected e.g. apply_sce=0)" << std::endl;
+            return false;
+          }
+          *flag = (value == "1");
+        }
+        variants.push_back(v);
+      }
+      if (variants.empty()) {
+        std::cerr << "VariantTrain: no variants in " << path << std::endl;
+        return false;
+      }
+      fVariants = variants;
+      return true;
+    }
+
+    // $WIREMOD_VARIANTS if set, otherwise base alone
+    static bool FromEnv(const Variant& base, VariantTrain& train) {
+      train = VariantTrain(base);
+      const char* path = getenv("WIREMOD_VARIANTS");
+      if (!path || !*path) return true;
+      return train.Load(path, base);
+    }
+
+    size_t Size() const { return fVariants.size(); }
+    const Variant& operator[](size_t v) const { return fVariants[v]; }
+    bool Single() const { return fVariants.size() == 1 && fVariants[0].name.empty(); }
+
+    // flag set in any / every variant, e.g. Any(&Variant::apply_sce)
+    bool Any(bool Variant::* flag) const {
+      for (const Variant& v : fVariants) if (v.*flag) return true;
+      return false;
+    }
+    bool All(bool Variant::* flag) const {
+      for (const Variant& v : fVariants) if (!(v.*flag)) return false;
+      return true;
+    }
+
+    // Hit mask that accepts every hit some variant accepts
+    HitMaskConfig SharedHitConfig(float thirds_tol) const {
+      Variant loosest = fVariants[0];
+      loosest.life_sel = All(&Variant::life_sel);
+      loosest.pathological_sel = All(&Variant::pathological_sel);
+      return loosest.HitConfig(thirds_tol);
+    }
+
+    // Index selection of every variant (each into its own cut flow), merged
+    // into one entry ordered list of the tracks some variant keeps
+    std::vector<ChainTrackIndex::Track> SelectIndex(const ChainTrackIndex& index, float length_cut, std::vector<CutFlow>& cutflows,
+                                                    Long64_t first, Long64_t last) const {
+      std::vector<ChainTrackIndex::Track> out;
+      for (size_t v = 0; v < fVariants.size(); v++) {
+        std::vector<ChainTrackIndex::Track> sel = index.Select(fVariants[v].TrackSel(length_cut), cutflows[v], first, last);
+        out.insert(out.end(), sel.begin(), sel.end());
+      }
+      auto by_entry = [](const ChainTrackIndex::Track& a, const ChainTrackIndex::Track& b) { return a.entry < b.entry; };
+      auto same_entry = [](const ChainTrackIndex::Track& a, const ChainTrackIndex::Track& b) { return a.entry == b.entry; };
+      std::sort(out.begin(), out.end(), by_entry);
+      out.erase(std::unique(out.begin(), out.end(), same_entry), out.end());
+      if (fVariants.size() > 1) printf("VariantTrain: %zu tracks pass some variant\n", out.size());
+      return out;
+    }
+
+    void Print() const {
+      printf("Variants (%zu):\n", fVariants.size());
+      for (const Variant& v : fVariants) v.Print();
+    }
+
+  private:
+
+    static bool Find(const std::vector<Variant>& variants, const std::string& name) {
+      for (const Variant& v : variants) if (v.name == name) return true;
+      return false;
+    }
+
+    std::vector<Variant> fVariants;
+
+};
+
+#endif
@@ -1,11 +1,14 @@
-
+#ifndef YZ_NONUNIFORMITY_H
+#define YZ_NONUNIFORMITY_H
 
 // YZ Nonuniformity Calibrations
 #include <TROOT.h>
+#include <TFile.h>
 #include <TH2F.h>
 #include <TString.h>
 #include <vector>
 #include <iostream>
+#include <cmath>
 #include "Math/Vector3D.h"
 
 using ROOT::Math::XYZVector;
@@ -15,31 +18,32 @@ using ROOT::Math::XYZVector;
 /*
 
   Nx = N planes and Ny = NTPCs
-  Function loads correction hists for each plane/TPC 
+  Function loads correction hists for each plane/TPC
 
 */
 template <int NX, int NY>
-void load_yz(TH2F (&hists)[NX][NY], const char* yz_file) {
+void load_yz(TH2F* (&hists)[NX][NY], const char* yz_file) {
 
     //TH2F* CzyHist_sce[kNplanes][2];
 
     TFile* file_SCEYZ = TFile::Open(yz_file, "READ");
     printf("wiremod_ndhist: Loading YZ nonuniformity correction histograms"
                 " from %s\n", yz_file);
-    
+
     for (int l = 0; l < NX; l++){
       for (int k = 0; k < NY; k++) {
         hists[l][k] = (TH2F*)file_SCEYZ->Get(Form("CzyHist_%i_%i",l,k));
+        if (hists[l][k]) hists[l][k]->SetDirectory(0);
       }
     }
     file_SCEYZ->Close();
-    
+
     std::cout << hists[0][0] << "\n";
 
 }
 
 template <int NX, int NY>
-double yz_corr(TH2F (&CzyHist_sce)[NX][NY], XYZVector sp, int ip, int tpc) {
+double yz_corr(TH2F* (&CzyHist_sce)[NX][NY], XYZVector sp, int ip, int tpc) {
 
 
   const int nbinz=100, nbinx=40, nbiny=80;
@@ -59,5 +63,4 @@ double yz_corr(TH2F (&CzyHist_sce)[NX][NY], XYZVector sp, int ip, int tpc) {
 
 }
 
-
-
+#endif
@@ -0,0 +1,259 @@
+#ifndef YZ_TABLE_H
+#define YZ_TABLE_H
+
+#include <TFile.h>
+#include <TH2F.h>
+#include <TString.h>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include "Math/Vector3D.h"
+
+using ROOT::Math::XYZVector;
+
+
+/*
+
+  Flat YZ correction table
+
+  All CzyHist_<plane>_<tpc> maps are copied once into a single contiguous,
+  64 byte aligned float array indexed as [plane][tpc][z][y]. The lookup uses
+  the same binning arithmetic as yz_corr() (YZNonuniformity.h), so the results are bit
+  identical, but it has no TH2F virtual calls and only one data dependent
+  select (in range ? table : 1) per hit. Correct() handles a whole track's
+  hit arrays for one plane in a single call.
+
+  TPC convention: x < 0 is TPC 0 (east), x >= 0 is TPC 1 (west).
+
+  Kept apart from YZNonuniformity.h, whose yz_corr() template would clash
+  with the fillers' global YZCorr *yz_corr.
+
+*/
+
+class YZTable {
+
+  public:
+
+    static constexpr int kNplanesYZ = 3;
+    static constexpr int kNTPCsYZ = 2;
+    static constexpr int kNbinZ = 100;
+    static constexpr int kNbinY = 80;
+    static constexpr int kNbinX = 40;
+    static constexpr int kNPerMap = kNbinZ * kNbinY;
+    static constexpr int kNTotal = kNplanesYZ * kNTPCsYZ * kNPerMap;
+
+    YZTable() { std::fill(fTable, fTable + kNTotal, 1.f); }
+
+    // Not copyable: fData may point into fTable
+    YZTable(const YZTable&) = delete;
+    YZTable& operator=(const YZTable&) = delete;
+
+    // Load from a map file with CzyHist_<plane>_<tpc> histograms
+    bool Load(const char* yz_file) {
+      TFile* f = TFile::Open(yz_file, "READ");
+      if (!f || f->IsZombie()) {
+        std::cerr << "YZTable: could not open " << yz_file << std::endl;
+        return false;
+      }
+      bool ok = true;
+      for (int l = 0; l < kNplanesYZ; l++) {
+        for (int k = 0; k < kNTPCsYZ; k++) {
+          TH2F* h = (TH2F*)f->Get(Form("CzyHist_%i_%i", l, k));
+          if (!h) {
+            std::cerr << "YZTable: missing CzyHist_" << l << "_" << k << " in " << yz_file << std::endl;
+            ok = false;
+            continue;
+          }
+          Fill(l, k, h);
+        }
+      }
+      f->Close();
+      delete f;
+      fLoaded = ok;
+      printf("YZTable: loaded %d maps (%zu kB) from %s\n", kNplanesYZ * kNTPCsYZ, sizeof(fTable) / 1024, yz_file);
+      return ok;
+    }
+
+    void Fill(int plane, int tpc, const TH2F* h) {
+      fData = fTable;
+      float* m = fTable + Offset(plane, tpc);
+      for (int iz = 0; iz < kNbinZ; iz++) {
+        for (int iy = 0; iy < kNbinY; iy++) {
+          m[iz * kNbinY + iy] = (float)h->GetBinContent(iz + 1, iy + 1);
+        }
+      }
+    }
+
+    bool Loaded() const { return fLoaded; }
+
+    // Use an external table with the same [plane][tpc][z][y] layout (e.g. a
+    // memory mapped calibration bundle) instead of the internal copy.
+    // The memory must outlive the table.
+    void Attach(const float* data) {
+      fData = data;
+      fLoaded = (data != nullptr);
+      if (!data) fData = fTable;
+    }
+
+    // Raw table (kNTotal floats), for writing bundles
+    const float* Data() const { return fData; }
+
+    // Single hit lookup (tpc derived from x)
+    inline float Lookup(int plane, double x, double y, double z) const {
+      int ix = (int)std::floor((x - kLowX) / (kHighX - kLowX) * kNbinX);
+      int iy = (int)std::floor((y - kLowY) / (kHighY - kLowY) * kNbinY);
+      int iz = (int)std::floor((z - kLowZ) / (kHighZ - kLowZ) * kNbinZ);
+      bool in = ((unsigned)ix < (unsigned)kNbinX) & ((unsigned)iy < (unsigned)kNbinY) & ((unsigned)iz < (unsigned)kNbinZ);
+      int tpc = (x >= 0.);
+      // clamp so the (discarded) out of range read stays inside the table
+      iy = std::min(std::max(iy, 0), kNbinY - 1);
+      iz = std::min(std::max(iz, 0), kNbinZ - 1);
+      float v = fData[Offset(plane, tpc) + iz * kNbinY + iy];
+      return in ? v : 1.f;
+    }
+
+    inline float Lookup(int plane, const XYZVector& sp) const {
+      return Lookup(plane, sp.X(), sp.Y(), sp.Z());
+    }
+
+    // Batched lookup for n hits of one plane: out[i] = correction factor
+    void Correct(int plane, size_t n, const float* x, const float* y, const float* z, float* out) const {
+      for (size_t i = 0; i < n; i++) {
+        out[i] = Lookup(plane, x[i], y[i], z[i]);
+      }
+    }
+
+    void Correct(int plane, size_t n, const double* x, const double* y, const double* z, float* out) const {
+      for (size_t i = 0; i < n; i++) {
+        out[i] = Lookup(plane, x[i], y[i], z[i]);
+      }
+    }
+
+    // Validation: compare every table entry with the TH2F it came from
+    template <int NX, int NY>
+    size_t Validate(TH2F* (&hists)[NX][NY]) const {
+      size_t nbad = 0;
+      for (int l = 0; l < NX && l < kNplanesYZ; l++) {
+        for (int k = 0; k < NY && k < kNTPCsYZ; k++) {
+          if (!hists[l][k]) continue;
+          const float* m = fData + Offset(l, k);
+          for (int iz = 0; iz < kNbinZ; iz++) {
+            for (int iy = 0; iy < kNbinY; iy++) {
+              float a = m[iz * kNbinY + iy];
+              float b = (float)hists[l][k]->GetBinContent(iz + 1, iy + 1);
+              if (std::memcmp(&a, &b, sizeof(float)) != 0) nbad++;
+            }
+          }
+        }
+      }
+      return nbad;
+    }
+
+  private:
+
+    static constexpr double kLowZ = 0, kHighZ = 500;
+    static constexpr double kLowY = -200, kHighY = 200;
+    static constexpr double kLowX = -200, kHighX = 200;
+
+    static inline int Offset(int plane, int tpc) { return (plane * kNTPCsYZ + tpc) * kNPerMap; }
+
+    alignas(64) float fTable[kNTotal];
+    const float* fData = fTable;
+    bool fLoaded = false;
+
+};
+
+
+/*
+
+  Comparison of the flat table against another YZ path (e.g.
+  YZCorr::GetYZCorr), on by default: CheckGrid() compares every bin center of
+  every map and points outside the map range once at setup, Check() the
+  first N hits of the job (WIREMOD_YZ_VALIDATE=N, default 1000, 0 turns both
+  off). Any difference that is not bit-exact is counted and reported; the
+  caller can use Failed() to fall back to the reference path.
+
+*/
+struct YZTableValidator {
+
+  static constexpr size_t kDefaultHits = 1000;
+
+  size_t nmax = 0;
+  size_t nchecked = 0;
+  size_t nbad = 0;
+  size_t ngrid = 0;
+
+  YZTableValidator(size_t n = 0) : nmax(n) {}
+
+  static YZTableValidator FromEnv() {
+    const char* v = getenv("WIREMOD_YZ_VALIDATE");
+    return YZTableValidator((v && *v) ? atol(v) : kDefaultHits);
+  }
+
+  bool Enabled() const { return nmax > 0; }
+  bool Active() const { return nchecked < nmax; }
+  bool Failed() const { return nbad > 0; }
+
+  void Check(float table_val, double ref_val, int plane, const XYZVector& sp) {
+    nchecked++;
+    Compare(table_val, ref_val, plane, sp);
+  }
+
+  // ref(plane, sp) -> reference factor
+  template <class Ref>
+  void CheckGrid(const YZTable& table, Ref ref) {
+    const double dz = 500. / YZTable::kNbinZ, dy = 400. / YZTable::kNbinY;
+    for (int l = 0; l < YZTable::kNplanesYZ; l++) {
+      for (int k = 0; k < YZTable::kNTPCsYZ; k++) {
+        double x = k ? 100. : -100.;
+        for (int iz = 0; iz < YZTable::kNbinZ; iz++) {
+          for (int iy = 0; iy < YZTable::kNbinY; iy++) {
+            XYZVector sp(x, -200. + (iy + 0.5) * dy, (iz + 0.5) * dz);
+            Compare(table.Lookup(l, sp), ref(l, sp), l, sp);
+            ngrid++;
+          }
+        }
+      }
+      const XYZVector outside[] = { XYZVector(-250., 0., 250.), XYZVector(250., 0., 250.), XYZVector(-100., -250., 250.),
+                                    XYZVector(100., 250., 250.), XYZVector(-100., 0., -10.), XYZVector(100., 0., 510.) };
+      for (const XYZVector& sp : outside) {
+        Compare(table.Lookup(l, sp), ref(l, sp), l, sp);
+        ngrid++;
+      }
+    }
+    printf("YZTable validation: %zu grid points checked, %zu mismatches\n", ngrid, nbad);
+  }
+
+  void Print() const {
+    if (nmax == 0) return;
+    printf("YZTable validation: %zu hits checked, %zu mismatches in total\n", nchecked, nbad);
+  }
+
+  private:
+
+  void Compare(float table_val, double ref_val, int plane, const XYZVector& sp) {
+    float ref = (float)ref_val;
+    if (std::memcmp(&table_val, &ref, sizeof(float)) != 0) {
+      nbad++;
+      if (nbad <= 10) {
+        fprintf(stderr, "YZTable mismatch: plane %d (%.3f, %.3f, %.3f) table=%.9g ref=%.9g\n",
+                plane, sp.X(), sp.Y(), sp.Z(), table_val, ref_val);
+      }
+    }
+  }
+};
+
+
+// Table from $SBND_YZCORR_PATH/<map_file> (map_file alone if unset), the
+// file YZCorr reads for yz_map_file(isData)
+inline bool initialize_yz_table(YZTable* yz_table, const TString& map_file) {
+  TString datapath = getenv("SBND_YZCORR_PATH");
+  TString yz_path = map_file;
+  if (datapath != "") yz_path = datapath + "/" + yz_path;
+  return yz_table -> Load(yz_path);
+}
+
+#endif
@@ -1,4 +1,18 @@
+#ifndef ELIFETIME_H
+#define ELIFETIME_H
 
+#include <cmath>
+#include <vector>
+#include <map>
+#include <array>
+#include <iostream>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <functional>
+
+#include "StageTimer.h"
 
 
 // Electron Lifteime Calculations
@@ -8,8 +22,7 @@
 
 // This returns a scale factor to apply to charges
 
-double lifetime_correction(double x, double tau) {
-    static const double v_drift = 156.267;
+double lifetime_correction(double x, double tau, double v_drift = 156.267) {
     double out = 1.;
     if(fabs(x) > 200.) return out;
 
@@ -20,4 +33,199 @@ double lifetime_correction(double x, double tau) {
 }
 
 
+/*
+
+  Tabulated lifetime correction
+
+  The correction exp(+t_drift / tau) is precomputed per TPC on a fine grid in
+  |x| over [0, 200] cm and linearly interpolated. With the default 0.05 cm step
+  the interpolation error is below (step / (v_drift * tau))^2 / 8, 1.3e-8 at
+  tau = 1 ms and 1e-11 at 35 ms, so the error of the returned value is the
+  float rounding (relative 6e-8, up to 1.2e-7 with the interpolation at 1 ms).
+
+  The table is built from lifetime_correction() unless SetReference() gives
+  another function of (x, tau), e.g. Lifetime_Correction of mylib.h that the
+  other fillers call, so the fillers agree by construction. MaxRelError()
+  compares with the same function over x in [-220, 220] cm, which also
+  catches a reference that is not symmetric in x or not 1 beyond the drift
+  volume. With a reference the drift velocity is the reference's own.
+
+  |x| is clamped to 200 cm, where the correction is exactly 1, so hits outside
+  the drift volume need no branch. The TPC only selects a table offset.
+
+  Per run taus can be registered with SetRunTau(); SetRun() then switches the
+  active tables once per track, not per hit. Runs without an entry go back to
+  the configured taus, so the result does not depend on the file order.
+
+*/
+
+class LifetimeCorr {
+
+  public:
+
+    static constexpr int kNTPCsLife = 2;
+    static constexpr double kMaxDrift = 200.; // cm
+
+    LifetimeCorr(double tau = 100., double v_drift = 156.267, double step = 0.05)
+      : fVDrift(v_drift), fStep(step), fInvStep(1. / step),
+        fNPoints((int)std::ceil(kMaxDrift / step) + 1) {
+      fTaus.fill(tau);
+      fBaseTaus = fTaus;
+      Build();
+    }
+
+    // Same tau for both TPCs
+    void Configure(double tau) { Configure(tau, tau); }
+
+    void Configure(double tau_tpc0, double tau_tpc1) {
+      fTaus = { tau_tpc0, tau_tpc1 };
+      fBaseTaus = fTaus;
+      fActiveRun = -1;
+      Build();
+    }
+
+    void SetVDrift(double v_drift) { fVDrift = v_drift; Build(); }
+
+    // Correction (x cm, tau ms) the table is built from and checked against
+    void SetReference(const std::string& name, std::function<double(double, double)> f) {
+      fRefName = name;
+      fRef = f;
+      Build();
+    }
+
+    // Per run lifetimes (ms). Runs without an entry use the configured taus.
+    void SetRunTau(int run, double tau_tpc0, double tau_tpc1) {
+      fRunTaus[run] = { tau_tpc0, tau_tpc1 };
+    }
+
+    // Text file with one "run tau_tpc0 tau_tpc1" entry per line ('#' comments)
+    int LoadRunTaus(const char* path) {
+      std::ifstream in(path);
+      if (!in) {
+        std::cerr << "LifetimeCorr: could not open " << path << std::endl;
+        return 0;
+      }
+      std::string line;
+      int n = 0;
+      while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream ss(line);
+        int run;
+        double t0, t1;
+        if (ss >> run >> t0 >> t1) {
+          SetRunTau(run, t0, t1);
+          n++;
+        }
+      }
+      printf("LifetimeCorr: loaded %d per-run lifetimes from %s\n", n, path);
+      return n;
+    }
+
+    void SetRun(int run) {
+      if (run == fActiveRun || fRunTaus.empty()) return;
+      auto it = fRunTaus.find(run);
+      const std::array<double, kNTPCsLife>& taus = (it == fRunTaus.end()) ? fBaseTaus : it->second;
+      fActiveRun = run;
+      if (taus == fTaus) return;
+      fTaus = taus;
+      Build();
+    }
+
+    double Tau(int tpc) const { return fTaus[tpc]; }
+    double VDrift() const { return fVDrift; }
+    const std::map<int, std::array<double, kNTPCsLife>>& RunTaus() const { return fRunTaus; }
+
+    // Single hit
+    inline float Correction(float x, int tpc) const {
+      double u = std::min((double)std::fabs(x), kMaxDrift) * fInvStep;
+      int i = std::min((int)u, fNPoints - 2);
+      double f = u - i;
+      const double* t = fTable.data() + tpc * fNPoints;
+      return (float)(t[i] + f * (t[i + 1] - t[i]));
+    }
+
+    // Whole track: out[i] = correction for hit i
+    void Correct(size_t n, const float* x, const unsigned short* tpc, float* out) const {
+      WIREMOD_PROF_SCOPE(kStageLifetime);
+      for (size_t k = 0; k < n; k++) {
+        out[k] = Correction(x[k], tpc[k]);
+      }
+    }
+
+    // Double precision positions (e.g. after SCE), converted like the scalar path
+    void Correct(size_t n, const double* x, const unsigned short* tpc, float* out) const {
+      WIREMOD_PROF_SCOPE(kStageLifetime);
+      for (size_t k = 0; k < n; k++) {
+        out[k] = Correction((float)x[k], tpc[k]);
+      }
+    }
+
+    // All hits in one TPC (no tpc array)
+    void Correct(size_t n, const float* x, int tpc, float* out) const {
+      WIREMOD_PROF_SCOPE(kStageLifetime);
+      const double* t = fTable.data() + tpc * fNPoints;
+      for (size_t k = 0; k < n; k++) {
+        double u = std::min((double)std::fabs(x[k]), kMaxDrift) * fInvStep;
+        int i = std::min((int)u, fNPoints - 2);
+        double f = u - i;
+        out[k] = (float)(t[i] + f * (t[i + 1] - t[i]));
+      }
+    }
+
+    // Largest relative deviation from the reference over a dense scan of
+    // x in [-1.1, 1.1] * 200 cm
+    double MaxRelError(int nscan = 100000) const {
+      double worst = 0.;
+      for (int tpc = 0; tpc < kNTPCsLife; tpc++) {
+        for (int k = 0; k <= nscan; k++) {
+          double x = 1.1 * kMaxDrift * (2. * k / nscan - 1.);
+          double exact = Reference(x, fTaus[tpc]);
+          worst = std::max(worst, std::fabs(Correction(x, tpc) - exact) / exact);
+        }
+      }
+      return worst;
+    }
+
+    void Print() const {
+      double err = MaxRelError(10000);
+      char vdrift[64] = "v_drift of the reference";
+      if (!fRef) snprintf(vdrift, sizeof(vdrift), "v_drift = %.3f cm/ms", fVDrift);
+      printf("LifetimeCorr: tau = (%.2f, %.2f) ms, %s, step = %.3f cm, max rel. error vs %s = %.2e\n",
+             fTaus[0], fTaus[1], vdrift, fStep, fRefName.c_str(), err);
+      if (err > 1e-6) {
+        std::cerr << "LifetimeCorr: the table differs from " << fRefName
+                  << " (not symmetric in x or not 1 beyond 200 cm?)" << std::endl;
+      }
+    }
+
+  private:
+
+    double Reference(double x, double tau) const {
+      return fRef ? fRef(x, tau) : lifetime_correction(x, tau, fVDrift);
+    }
+
+    void Build() {
+      fTable.resize(kNTPCsLife * fNPoints);
+      for (int tpc = 0; tpc < kNTPCsLife; tpc++) {
+        for (int i = 0; i < fNPoints; i++) {
+          fTable[tpc * fNPoints + i] = Reference(std::min(i * fStep, kMaxDrift), fTaus[tpc]);
+        }
+      }
+    }
+
+    double fVDrift;
+    double fStep;
+    double fInvStep;
+    int fNPoints;
+    std::array<double, kNTPCsLife> fTaus;
+    std::array<double, kNTPCsLife> fBaseTaus;  // Configure(), for runs without an entry
+    std::vector<double> fTable;
+    std::string fRefName = "lifetime_correction";
+    std::function<double(double, double)> fRef;
+
+    std::map<int, std::array<double, kNTPCsLife>> fRunTaus;
+    int fActiveRun = -1;
+
+};
 
+#endif
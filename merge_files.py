@@ -11,11 +11,12 @@ def hadd(output, inputs, threads=8):
     cmd = ["hadd", "-f", f"-j{threads}", str(output)] + [str(f) for f in inputs]
     subprocess.run(cmd, check=True, stdout=subprocess.DEVNULL, stderr=subprocess.STDOUT)
 
-def merge_in_chunks(input_dir, output_dir, final_name, chunk_size=100, threads=8):
+def merge_in_chunks(input_dir, output_dir, final_name, chunk_size=100, threads=8, files=None):
+    """Merge every *.root of input_dir, or only the given files (e.g. the outputs of one run)."""
     input_dir, output_dir = Path(input_dir), Path(output_dir)
     output_dir.mkdir(parents=True, exist_ok=True)
 
-    files = sorted(input_dir.glob("*.root"))
+    files = sorted(Path(f) for f in files) if files is not None else sorted(input_dir.glob("*.root"))
     n_files = len(files)
     n_chunks = ceil(n_files / chunk_size)
     print(f"Found {n_files} files → {n_chunks} chunks of {chunk_size}")